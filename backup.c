@@ -3,18 +3,36 @@
 #include <stdlib.h>
 #include <math.h>
 #include <pthread.h>
+#include <stdbool.h>
 
+// Headless builds (-DHEADLESS) keep only the timing line for the benchmark
+#ifdef HEADLESS
+#define trace(...) ((void) 0)
+#else
+#define trace(...) printf(__VA_ARGS__)
+#endif
 
+
+#ifndef GRID_SIZE
 #define GRID_SIZE 30
+#endif
 
+#ifndef PLANTS
 #define PLANTS 100
+#endif
+#ifndef HERBIVORES
 #define HERBIVORES 100
+#endif
+#ifndef CARNIVORES
 #define CARNIVORES 50
+#endif
 
 #define HERBIVORE_OLD 50
 #define CARNIVORE_OLD 50
 
+#ifndef MAX_TICKS
 #define MAX_TICKS 1500
+#endif
 #define STARVATION 10
 
 #define COLOR_PLANT "\x1b[32m"
@@ -143,7 +161,7 @@ void update_herbivore(EcoSystem *ecoSystem){
                 // Death by starvation
                 if (ecoSystem->grid[i][j].starve > STARVATION) {
                     omp_set_lock(&ecoSystem->locks[i][j]);
-                    printf("Herbivore died by starvation\n");
+                    trace("Herbivore died by starvation\n");
                     ecoSystem->grid[i][j] = (Cell){0, 0, 0, false, EMPTY};  // The herbivore dies
                     omp_unset_lock(&ecoSystem->locks[i][j]);
 
@@ -157,7 +175,7 @@ void update_herbivore(EcoSystem *ecoSystem){
                 double r = (double) rand() / RAND_MAX;
                 if (r < death_by_age) {
                     omp_set_lock(&ecoSystem->locks[i][j]);
-                    printf("Herbivore died by age\n");
+                    trace("Herbivore died by age\n");
                     ecoSystem->grid[i][j] = (Cell){0, 0, 0, false, EMPTY}; // The herbivore dies
                     omp_unset_lock(&ecoSystem->locks[i][j]);
                     continue;
@@ -328,7 +346,7 @@ void update_carnivore(EcoSystem *ecoSystem){
                     omp_unset_lock(&ecoSystem->locks[x][y]);
                     omp_unset_lock(&ecoSystem->locks[i][j]);
 
-                    printf("Carnivore ate herbivore\n");
+                    trace("Carnivore ate herbivore\n");
                 } else if (ecoSystem -> grid[x][y].type == EMPTY){
                     ecoSystem -> grid[i][j].starve += 1;
 
@@ -411,13 +429,24 @@ void init_ecosystem(EcoSystem *ecoSystem) {
 }
 
 
+#ifdef HEADLESS
+// Headless benchmark build: no output but the timing line, the tick count comes from the command line
+// and the team size from OMP_NUM_THREADS
+int main(int argc, char **argv) {
+    int max_ticks = argc > 1 ? atoi(argv[1]) : MAX_TICKS;
+#else
 int main() {
+    int max_ticks = MAX_TICKS;
     omp_set_num_threads(4);
-    EcoSystem ecoSystem;
+#endif
+    static EcoSystem ecoSystem;     // Static, so that large grids do not overflow the stack
     init_ecosystem(&ecoSystem);
 
+#ifdef HEADLESS
+    double start = omp_get_wtime();
+#endif
     int i;
-    for(i = 0; i < MAX_TICKS; i++) {
+    for(i = 0; i < max_ticks; i++) {
 #pragma barrier
         reset_acted(&ecoSystem);
 
@@ -444,11 +473,11 @@ int main() {
                 }
             }
         }
-        printf("%d Plants: %d, Herbivores: %d, Carnivores: %d\n", i, count_plants, count_herbivores, count_carnivores);
-        printf("\n");
+        trace("%d Plants: %d, Herbivores: %d, Carnivores: %d\n", i, count_plants, count_herbivores, count_carnivores);
+        trace("\n");
 
         if (count_herbivores == 0 || count_carnivores == 0) {
-            printf("Early stop\n");
+            trace("Early stop\n");
             break;
         }
 
@@ -467,27 +496,30 @@ int main() {
 
     }
 
-    printf("Final state\n");
+#ifdef HEADLESS
+    printf("bench ticks=%d seconds=%.6f\n", i, omp_get_wtime() - start);
+#endif
+    trace("Final state\n");
     for (int t = 0; t < GRID_SIZE; t++) {
         for (int k = 0; k < GRID_SIZE; k++) {
             switch (ecoSystem.grid[t][k].type) {
                 case EMPTY:
-                    printf(" %sE%s ", COLOR_EMPTY, COLOR_RESET);
+                    trace(" %sE%s ", COLOR_EMPTY, COLOR_RESET);
                     break;
                 case PLANT:
-                    printf(" %sP%s ", COLOR_PLANT, COLOR_RESET);
+                    trace(" %sP%s ", COLOR_PLANT, COLOR_RESET);
                     break;
                 case HERBIVORE:
-                    printf(" %sH%s ", COLOR_HERBIVORE, COLOR_RESET);
+                    trace(" %sH%s ", COLOR_HERBIVORE, COLOR_RESET);
                     break;
                 case CARNIVORE:
-                    printf(" %sC%s ", COLOR_CARNIVORE, COLOR_RESET);
+                    trace(" %sC%s ", COLOR_CARNIVORE, COLOR_RESET);
                     break;
             }
         }
-        printf("\n");
+        trace("\n");
     }
-    printf("Tick %d\n", i);
+    trace("Tick %d\n", i);
 
 
 
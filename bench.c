@@ -0,0 +1,403 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define MAX_LIST 16
+#define MIN_TICKS 2
+#define MAX_TICKS 1000
+#define MAX_TRIALS 64
+
+// One measured point of the matrix
+typedef struct {
+    const char *program;
+    int size;
+    int density;
+    int threads;
+    int ticks;              // Ticks of the last trial (early stops can shorten a run)
+    double median;          // Ticks per second over the trials
+    double min;
+    double max;
+    double cell_updates;    // median * size * size
+    double efficiency;      // median / (threads * median with 1 thread), NAN without a 1-thread point
+} BenchResult;
+
+typedef struct {
+    const char *bin_dir;
+    char *programs[MAX_LIST];
+    int program_count;
+    int sizes[MAX_LIST];
+    int size_count;
+    int densities[MAX_LIST];
+    int density_count;
+    int threads[MAX_LIST];
+    int thread_count;
+    long long budget;       // Cell updates per trial, which sets the ticks of every size
+    int warmup;
+    int trials;
+    const char *csv_path;
+    const char *json_path;
+} BenchConfig;
+
+// Function to split a comma-separated list of positive integers
+static int parse_int_list(const char *name, const char *value, int *out, int *count) {
+    char copy[256];
+    snprintf(copy, sizeof(copy), "%s", value);
+
+    *count = 0;
+    for (char *item = strtok(copy, ","); item != NULL; item = strtok(NULL, ",")) {
+        char *end;
+        long parsed = strtol(item, &end, 10);
+        if (end == item || *end != '\0' || parsed < 1 || parsed > 1000000 || *count == MAX_LIST) {
+            fprintf(stderr, "Invalid value for %s: '%s'\n", name, value);
+            return -1;
+        }
+        out[(*count)++] = (int) parsed;
+    }
+    return *count > 0 ? 0 : -1;
+}
+
+// Function to parse an integer of at least `min`
+static int parse_count(const char *value, int min, int *out) {
+    char *end;
+    long parsed = strtol(value, &end, 10);
+    if (end == value || *end != '\0' || parsed < min || parsed > 1000000) return -1;
+    *out = (int) parsed;
+    return 0;
+}
+
+// Function to split a comma-separated list of program names
+static int parse_program_list(const char *value, BenchConfig *config) {
+    static const char *known[] = {"locked", "buffered", "tiles", "sparse", "backup", "non_parallel"};
+    char *copy = strdup(value);
+
+    config->program_count = 0;
+    for (char *item = strtok(copy, ","); item != NULL; item = strtok(NULL, ",")) {
+        int found = 0;
+        for (int k = 0; k < 6; k++) {
+            if (strcmp(item, known[k]) == 0) found = 1;
+        }
+        if (!found || config->program_count == MAX_LIST) {
+            fprintf(stderr, "Unknown program '%s'\n", item);
+            return -1;
+        }
+        config->programs[config->program_count++] = item;
+    }
+    return config->program_count > 0 ? 0 : -1;
+}
+
+// Function to print the command line help
+static void usage(const char *program) {
+    printf("Usage: %s [options]\n", program);
+    printf("  --bin-dir DIR      directory of MiniProyecto_1 and the headless backup_/non_parallel_ builds (default .)\n");
+    printf("  --programs LIST    any of locked, buffered, tiles, sparse (main.c engines), backup, non_parallel\n");
+    printf("  --sizes LIST       grid sides (default 80,512,2048,8192)\n");
+    printf("  --densities LIST   percent of the cells holding an agent (default 10,30,60)\n");
+    printf("  --threads LIST     OpenMP team sizes (default 1, 2, 4, ... up to the online CPUs)\n");
+    printf("  --budget N         cell updates per trial, giving %d to %d ticks per run (default 200000000)\n",
+           MIN_TICKS, MAX_TICKS);
+    printf("  --warmup N         discarded runs before every point (default 1)\n");
+    printf("  --trials N         measured runs of every point, at most %d (default 3)\n", MAX_TRIALS);
+    printf("  --csv FILE         CSV report (default bench.csv)\n");
+    printf("  --json FILE        JSON report (default bench.json)\n");
+}
+
+// Function to parse the command line
+static int parse_bench_config(BenchConfig *config, int argc, char **argv) {
+    *config = (BenchConfig) {
+        .bin_dir = ".",
+        .sizes = {80, 512, 2048, 8192},
+        .size_count = 4,
+        .densities = {10, 30, 60},
+        .density_count = 3,
+        .budget = 200000000LL,
+        .warmup = 1,
+        .trials = 3,
+        .csv_path = "bench.csv",
+        .json_path = "bench.json",
+    };
+    if (parse_program_list("locked,buffered,tiles,sparse,backup,non_parallel", config) != 0) return -1;
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    for (int t = 1; config->thread_count < MAX_LIST; t *= 2) {
+        config->threads[config->thread_count++] = t;
+        if (t >= cpus) break;
+    }
+
+    for (int a = 1; a < argc; a++) {
+        const char *option = argv[a];
+        if (strcmp(option, "-h") == 0 || strcmp(option, "--help") == 0) {
+            usage(argv[0]);
+            exit(0);
+        }
+        if (a + 1 == argc) {
+            usage(argv[0]);
+            return -1;
+        }
+        const char *value = argv[++a];
+        int status = 0;
+        if (strcmp(option, "--bin-dir") == 0) {
+            config->bin_dir = value;
+        } else if (strcmp(option, "--programs") == 0) {
+            status = parse_program_list(value, config);
+        } else if (strcmp(option, "--sizes") == 0) {
+            status = parse_int_list("--sizes", value, config->sizes, &config->size_count);
+        } else if (strcmp(option, "--densities") == 0) {
+            status = parse_int_list("--densities", value, config->densities, &config->density_count);
+            for (int d = 0; status == 0 && d < config->density_count; d++) {
+                if (config->densities[d] > 100) status = -1;
+            }
+        } else if (strcmp(option, "--threads") == 0) {
+            status = parse_int_list("--threads", value, config->threads, &config->thread_count);
+        } else if (strcmp(option, "--budget") == 0) {
+            char *end;
+            config->budget = strtoll(value, &end, 10);
+            status = end != value && *end == '\0' && config->budget > 0 ? 0 : -1;
+        } else if (strcmp(option, "--warmup") == 0) {
+            status = parse_count(value, 0, &config->warmup);
+        } else if (strcmp(option, "--trials") == 0) {
+            status = parse_count(value, 1, &config->trials) == 0 && config->trials <= MAX_TRIALS ? 0 : -1;
+        } else if (strcmp(option, "--csv") == 0) {
+            config->csv_path = value;
+        } else if (strcmp(option, "--json") == 0) {
+            config->json_path = value;
+        } else {
+            status = -1;
+        }
+        if (status != 0) {
+            fprintf(stderr, "Invalid option '%s %s'\n", option, value);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Function to split a density into the initial populations, in main.c's default 4:3:1 proportion.
+// CMakeLists.txt computes the same numbers for the headless backup and non_parallel builds.
+static void populations(int size, int density, long long counts[3]) {
+    long long agents = (long long) size * size * density / 100;
+    counts[0] = agents / 2;
+    counts[1] = agents * 3 / 8;
+    counts[2] = agents - counts[0] - counts[1];
+}
+
+// Function to run one program with `threads` OpenMP threads and read back its timing line;
+// returns 0 and fills ticks and seconds on success
+static int run_once(char *const args[], int threads, int *ticks, double *seconds) {
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0) return -1;
+
+    fflush(stdout);
+    pid_t child = fork();
+    if (child < 0) {
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        return -1;
+    }
+    if (child == 0) {
+        char team[16];
+        snprintf(team, sizeof(team), "%d", threads);
+        setenv("OMP_NUM_THREADS", team, 1);
+        dup2(pipe_fds[1], STDOUT_FILENO);
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        execv(args[0], args);
+        fprintf(stderr, "Error running '%s'\n", args[0]);
+        _exit(127);
+    }
+
+    close(pipe_fds[1]);
+    FILE *out = fdopen(pipe_fds[0], "r");
+    char line[512];
+    int found = 0;
+    while (out != NULL && fgets(line, sizeof(line), out) != NULL) {
+        if (sscanf(line, "bench ticks=%d seconds=%lf", ticks, seconds) == 2) found = 1;
+    }
+    if (out != NULL) fclose(out);
+
+    int status;
+    if (waitpid(child, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) return -1;
+    return found && *ticks > 0 && *seconds > 0 ? 0 : -1;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+// Function to measure one point of the matrix: warm-up runs, then `trials` timed runs
+static int measure(const BenchConfig *config, const char *program, int size, int density, int threads,
+                   BenchResult *result) {
+    long long cells = (long long) size * size;
+    long long ticks = config->budget / cells;
+    if (ticks < MIN_TICKS) ticks = MIN_TICKS;
+    if (ticks > MAX_TICKS) ticks = MAX_TICKS;
+
+    char binary[512], ticks_arg[32], size_arg[32], counts_arg[3][32];
+    char *args[24];
+    int n = 0;
+    if (strcmp(program, "backup") == 0 || strcmp(program, "non_parallel") == 0) {
+        // Sizes and populations are compiled in, only the tick count is passed
+        snprintf(binary, sizeof(binary), "%s/%s_%d_%d", config->bin_dir, program, size, density);
+        snprintf(ticks_arg, sizeof(ticks_arg), "%lld", ticks);
+        args[n++] = binary;
+        args[n++] = ticks_arg;
+    } else {
+        long long counts[3];
+        populations(size, density, counts);
+        snprintf(binary, sizeof(binary), "%s/MiniProyecto_1", config->bin_dir);
+        snprintf(ticks_arg, sizeof(ticks_arg), "%lld", ticks);
+        snprintf(size_arg, sizeof(size_arg), "%d", size);
+        for (int s = 0; s < 3; s++) {
+            snprintf(counts_arg[s], sizeof(counts_arg[s]), "%lld", counts[s]);
+        }
+        char *main_args[] = {binary, "--engine", (char *) program, "--size", size_arg,
+                             "--plants", counts_arg[0], "--herbivores", counts_arg[1],
+                             "--carnivores", counts_arg[2], "--max-ticks", ticks_arg,
+                             "--debug-tick", "0", "--log", "/dev/null", "--bench"};
+        for (size_t a = 0; a < sizeof(main_args) / sizeof(main_args[0]); a++) {
+            args[n++] = main_args[a];
+        }
+    }
+    args[n] = NULL;
+
+    if (access(binary, X_OK) != 0) {
+        fprintf(stderr, "Skipping %s %dx%d at %d%%: '%s' is not built\n", program, size, size, density, binary);
+        return -1;
+    }
+
+    int run_ticks;
+    double seconds;
+    for (int w = 0; w < config->warmup; w++) {
+        if (run_once(args, threads, &run_ticks, &seconds) != 0) {
+            fprintf(stderr, "'%s' failed\n", binary);
+            return -1;
+        }
+    }
+
+    double rates[MAX_TRIALS];
+    int trials = config->trials;
+    for (int t = 0; t < trials; t++) {
+        if (run_once(args, threads, &run_ticks, &seconds) != 0) {
+            fprintf(stderr, "'%s' failed\n", binary);
+            return -1;
+        }
+        rates[t] = run_ticks / seconds;
+    }
+    qsort(rates, trials, sizeof(double), compare_doubles);
+
+    *result = (BenchResult) {
+        .program = program,
+        .size = size,
+        .density = density,
+        .threads = threads,
+        .ticks = run_ticks,
+        .median = trials % 2 == 1 ? rates[trials / 2] : (rates[trials / 2 - 1] + rates[trials / 2]) / 2,
+        .min = rates[0],
+        .max = rates[trials - 1],
+        .efficiency = NAN,
+    };
+    result->cell_updates = result->median * cells;
+    return 0;
+}
+
+// Function to fill in the scaling efficiency of every point against its 1-thread point
+static void scaling_efficiency(BenchResult *results, int count) {
+    for (int r = 0; r < count; r++) {
+        for (int base = 0; base < count; base++) {
+            if (results[base].threads == 1 && results[base].size == results[r].size
+                && results[base].density == results[r].density
+                && strcmp(results[base].program, results[r].program) == 0) {
+                results[r].efficiency = results[r].median / (results[r].threads * results[base].median);
+            }
+        }
+    }
+}
+
+static void write_csv(FILE *file, const BenchResult *results, int count) {
+    fprintf(file, "program,size,density,threads,ticks,ticks_per_sec,ticks_per_sec_min,ticks_per_sec_max,"
+                  "cell_updates_per_sec,efficiency\n");
+    for (int r = 0; r < count; r++) {
+        const BenchResult *p = &results[r];
+        fprintf(file, "%s,%d,%d,%d,%d,%.3f,%.3f,%.3f,%.0f,", p->program, p->size, p->density, p->threads,
+                p->ticks, p->median, p->min, p->max, p->cell_updates);
+        if (!isnan(p->efficiency)) fprintf(file, "%.3f", p->efficiency);
+        fprintf(file, "\n");
+    }
+}
+
+static void write_json(FILE *file, const BenchConfig *config, const BenchResult *results, int count) {
+    fprintf(file, "{\n  \"budget\": %lld,\n  \"warmup\": %d,\n  \"trials\": %d,\n  \"results\": [\n",
+            config->budget, config->warmup, config->trials);
+    for (int r = 0; r < count; r++) {
+        const BenchResult *p = &results[r];
+        fprintf(file, "    {\"program\": \"%s\", \"size\": %d, \"density\": %d, \"threads\": %d, \"ticks\": %d, "
+                      "\"ticks_per_sec\": %.3f, \"ticks_per_sec_min\": %.3f, \"ticks_per_sec_max\": %.3f, "
+                      "\"cell_updates_per_sec\": %.0f, \"efficiency\": ",
+                p->program, p->size, p->density, p->threads, p->ticks, p->median, p->min, p->max,
+                p->cell_updates);
+        if (isnan(p->efficiency)) {
+            fprintf(file, "null");
+        } else {
+            fprintf(file, "%.3f", p->efficiency);
+        }
+        fprintf(file, "}%s\n", r + 1 < count ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+}
+
+// Runs the engines headless over a matrix of grid sizes, densities and thread counts
+int main(int argc, char **argv) {
+    BenchConfig config;
+    if (parse_bench_config(&config, argc, argv) != 0) {
+        return 1;
+    }
+
+    int capacity = config.program_count * config.size_count * config.density_count * config.thread_count;
+    BenchResult *results = malloc(capacity * sizeof(BenchResult));
+    if (results == NULL) {
+        return 1;
+    }
+
+    int count = 0;
+    for (int p = 0; p < config.program_count; p++) {
+        const char *program = config.programs[p];
+        for (int s = 0; s < config.size_count; s++) {
+            for (int d = 0; d < config.density_count; d++) {
+                for (int t = 0; t < config.thread_count; t++) {
+                    // The serial baseline ignores the team size
+                    if (strcmp(program, "non_parallel") == 0 && config.threads[t] != 1) continue;
+
+                    BenchResult *result = &results[count];
+                    if (measure(&config, program, config.sizes[s], config.densities[d], config.threads[t],
+                                result) != 0) {
+                        break;   // Larger teams of a failing point would fail too
+                    }
+                    printf("%-12s %5dx%-5d %3d%% %3d threads: %10.2f ticks/s %14.0f cell updates/s\n",
+                           program, result->size, result->size, result->density, result->threads,
+                           result->median, result->cell_updates);
+                    count++;
+                }
+            }
+        }
+    }
+    scaling_efficiency(results, count);
+
+    FILE *csv = fopen(config.csv_path, "w");
+    FILE *json = fopen(config.json_path, "w");
+    if (csv == NULL || json == NULL) {
+        fprintf(stderr, "Error opening the reports '%s' and '%s'\n", config.csv_path, config.json_path);
+        return 1;
+    }
+    write_csv(csv, results, count);
+    write_json(json, &config, results, count);
+    fclose(csv);
+    fclose(json);
+    printf("%d points written to %s and %s\n", count, config.csv_path, config.json_path);
+
+    free(results);
+    return 0;
+}
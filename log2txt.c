@@ -0,0 +1,44 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "logwriter.h"
+
+// Converts a binary tick log (--log-format binary) back into the text iter.log format
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s LOG [OUTPUT]\n", argv[0]);
+        return 1;
+    }
+
+    FILE *in = fopen(argv[1], "rb");
+    if (in == NULL) {
+        fprintf(stderr, "Error opening '%s'\n", argv[1]);
+        return 1;
+    }
+
+    char magic[8];
+    if (fread(magic, sizeof(magic), 1, in) != 1 || memcmp(magic, LOG_MAGIC, sizeof(magic)) != 0) {
+        fprintf(stderr, "'%s' is not a binary tick log\n", argv[1]);
+        fclose(in);
+        return 1;
+    }
+
+    FILE *out = argc == 3 ? fopen(argv[2], "w") : stdout;
+    if (out == NULL) {
+        fprintf(stderr, "Error opening '%s'\n", argv[2]);
+        fclose(in);
+        return 1;
+    }
+
+    TickRecord records[4096];
+    size_t count;
+    while ((count = fread(records, sizeof(TickRecord), 4096, in)) > 0) {
+        for (size_t r = 0; r < count; r++) {
+            log_format_text(out, &records[r]);
+        }
+    }
+
+    fclose(in);
+    if (out != stdout) fclose(out);
+    return 0;
+}
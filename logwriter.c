@@ -0,0 +1,111 @@
+#define _POSIX_C_SOURCE 200809L  // nanosleep
+
+#include "logwriter.h"
+
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LOG_IDLE_NS 1000000L        // Writer thread sleep when the ring is empty
+
+void log_format_text(FILE *file, const TickRecord *record) {
+    fprintf(file, "Tick %u: Plants: %u, Herbivores: %u, Carnivores: %u\n",
+            record->tick, record->plants, record->herbivores, record->carnivores);
+}
+
+// Function to write records [from, to) of the ring, which never wrap inside the range
+static void write_records(LogWriter *writer, size_t from, size_t to) {
+    const TickRecord *records = &writer->ring[from & (writer->capacity - 1)];
+    size_t count = to - from;
+
+    if (writer->format == LOG_BINARY) {
+        fwrite(records, sizeof(TickRecord), count, writer->file);
+    } else {
+        for (size_t r = 0; r < count; r++) {
+            log_format_text(writer->file, &records[r]);
+        }
+    }
+}
+
+static void *writer_main(void *argument) {
+    LogWriter *writer = argument;
+    const struct timespec idle = {0, LOG_IDLE_NS};
+
+    for (;;) {
+        // Read `closing` before `head`, so a close request never hides records pushed before it
+        bool closing = atomic_load_explicit(&writer->closing, memory_order_acquire);
+        size_t head = atomic_load_explicit(&writer->head, memory_order_acquire);
+        size_t tail = atomic_load_explicit(&writer->tail, memory_order_relaxed);
+
+        if (head == tail) {
+            if (closing) break;
+            nanosleep(&idle, NULL);
+            continue;
+        }
+
+        // Stop at the end of the ring so the batch is contiguous
+        size_t end = tail - (tail & (writer->capacity - 1)) + writer->capacity;
+        size_t to = head < end ? head : end;
+        write_records(writer, tail, to);
+        atomic_store_explicit(&writer->tail, to, memory_order_release);
+    }
+
+    fflush(writer->file);
+    return NULL;
+}
+
+int log_writer_open(LogWriter *writer, const char *path, LogFormat format) {
+    memset(writer, 0, sizeof(*writer));
+    writer->format = format;
+    writer->capacity = LOG_RING_CAPACITY;
+    writer->ring = malloc(writer->capacity * sizeof(TickRecord));
+    writer->file = fopen(path, format == LOG_BINARY ? "wb" : "w");
+
+    if (writer->ring == NULL || writer->file == NULL) {
+        free(writer->ring);
+        if (writer->file != NULL) fclose(writer->file);
+        return -1;
+    }
+
+    if (format == LOG_BINARY) {
+        char magic[8] = LOG_MAGIC;
+        fwrite(magic, sizeof(magic), 1, writer->file);
+    }
+
+    atomic_init(&writer->head, 0);
+    atomic_init(&writer->tail, 0);
+    atomic_init(&writer->closing, false);
+
+    if (pthread_create(&writer->thread, NULL, writer_main, writer) != 0) {
+        free(writer->ring);
+        fclose(writer->file);
+        return -1;
+    }
+
+    return 0;
+}
+
+void log_writer_push(LogWriter *writer, TickRecord record) {
+    size_t head = atomic_load_explicit(&writer->head, memory_order_relaxed);
+
+    if (head - atomic_load_explicit(&writer->tail, memory_order_acquire) == writer->capacity) {
+        writer->stalls++;
+        while (head - atomic_load_explicit(&writer->tail, memory_order_acquire) == writer->capacity) {
+            sched_yield();
+        }
+    }
+
+    writer->ring[head & (writer->capacity - 1)] = record;
+    atomic_store_explicit(&writer->head, head + 1, memory_order_release);
+}
+
+void log_writer_close(LogWriter *writer) {
+    atomic_store_explicit(&writer->closing, true, memory_order_release);
+    pthread_join(writer->thread, NULL);
+
+    fclose(writer->file);
+    free(writer->ring);
+    writer->file = NULL;
+    writer->ring = NULL;
+}
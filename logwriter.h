@@ -0,0 +1,55 @@
+#ifndef LOGWRITER_H
+#define LOGWRITER_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#define LOG_MAGIC "ECOLOG1"         // First 8 bytes (with the terminator) of a binary log
+#ifndef LOG_RING_CAPACITY
+#define LOG_RING_CAPACITY 65536     // Records buffered between the simulation and the writer thread (power of two)
+#endif
+#define LOG_CACHE_LINE 64
+
+// One tick of the log, 16 bytes on disk
+typedef struct {
+    uint32_t tick;
+    uint32_t plants;
+    uint32_t herbivores;
+    uint32_t carnivores;
+} TickRecord;
+
+typedef enum {
+    LOG_TEXT,       // "Tick N: Plants: ..." lines, as iter.log always had
+    LOG_BINARY      // LOG_MAGIC followed by raw TickRecords
+} LogFormat;
+
+// Background writer fed by a single-producer single-consumer lock-free ring.
+// The simulation thread only copies a record into the ring; formatting and
+// I/O happen on the writer thread.
+typedef struct {
+    FILE *file;
+    LogFormat format;
+    TickRecord *ring;
+    size_t capacity;                                    // Power of two
+    _Alignas(LOG_CACHE_LINE) _Atomic size_t head;       // Next slot the simulation writes
+    _Alignas(LOG_CACHE_LINE) _Atomic size_t tail;       // Next slot the writer thread reads
+    _Alignas(LOG_CACHE_LINE) _Atomic bool closing;
+    long long stalls;                                   // Pushes that found the ring full
+    pthread_t thread;
+} LogWriter;
+
+int log_writer_open(LogWriter *writer, const char *path, LogFormat format);
+
+// Function to queue one record; only waits if the writer thread is a whole ring behind
+void log_writer_push(LogWriter *writer, TickRecord record);
+
+// Function to flush every queued record, stop the writer thread and close the file
+void log_writer_close(LogWriter *writer);
+
+// Function to write one record as a line of the text log
+void log_format_text(FILE *file, const TickRecord *record);
+
+#endif
@@ -1,11 +1,31 @@
+#define _GNU_SOURCE   // sched_setaffinity and the CPU_* macros of --workers
+
 #include <stdio.h>
 #include <omp.h>
 #include <stdlib.h>
 #include <math.h>
 #include <pthread.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdatomic.h>
+
+#include "logwriter.h"
+#include "snapshot.h"
+#include "stats.h"
+#include "trace.h"
 
 
+// Defaults, overridable from the command line or a config file (see usage())
 #define GRID_SIZE 80        // Size of the grid
 
 #define PLANTS 2000         // Number of plants
@@ -18,6 +38,14 @@
 #define MAX_TICKS 10000     // Number of iterations
 #define DEBUG_TICK 500      // Number of iterations before printing the state of the grid
 #define STARVATION 10       // Number of iterations before herbivores and carnivores die of starvation
+#define SEED 1              // Seed of the random streams
+#define TILE_SIZE 32        // Tile side of the tiles engine and of the work-stealing scheduler
+
+#define GRID_ALIGNMENT 64   // Alignment (bytes) of the heap-allocated grid
+#define HUGE_PAGE_SIZE (2UL << 20)   // Size of the huge pages of --huge-pages
+#define CHECKPOINT_MAGIC "ECOCKPT1"   // First 8 bytes of a checkpoint file
+#define CHECKPOINT_PLANTS "ECOPLNT1"  // First 8 bytes of the plant events section that may follow the planes
+#define MAX_WORKERS 64      // Strip worker processes of --workers
 
 // Colors for the grid
 #define COLOR_PLANT "\x1b[32m"
@@ -34,7 +62,7 @@ typedef enum {
     EMPTY
 } CellType;
 
-// Cell structure
+// Cell structure, the unpacked view of one cell of the planes below
 typedef struct {
     int energy;
     int age;
@@ -43,465 +71,4614 @@ typedef struct {
     CellType type;
 } Cell;
 
+// Cell storage as a structure of arrays: one row-major plane per field, each
+// sized to the range the field really takes. The hot type scans only touch the
+// one-byte type plane. Every plane is padded with a ring of ghost cells one
+// cell wide (see AT), so the neighbours of any cell can be read unchecked.
+typedef struct {
+    uint8_t *type;       // CellType
+    uint16_t *energy;    // Saturates at UINT16_MAX
+    uint8_t *age;        // Saturates at UINT8_MAX, far beyond the ages agents die at
+    uint8_t *starve;     // Saturates at UINT8_MAX
+    uint16_t *acted;     // Epoch of the tick the agent last acted in, NULL for engines that do not track it
+    uint16_t epoch;      // Epoch of the current tick, 1 to ACTED_EPOCHS; 0 in `acted` never matches it
+} Planes;
+
+#define ACTED_EPOCHS UINT16_MAX   // Ticks between sweeps clearing `acted` (see begin_acted)
 
-// Ecosystem structure
+
+// Tick engines
+typedef enum {
+    ENGINE_LOCKED,      // In-place updates guarded by one lock per cell
+    ENGINE_BUFFERED,    // Lock-free, reads tick N from one buffer and writes tick N + 1 into another
+    ENGINE_TILES,       // Lock-free, in-place updates of 2x2-coloured tiles, one colour at a time
+    ENGINE_SPARSE,      // Like ENGINE_LOCKED, but only visits the cells in per-species agent lists
+    ENGINE_BATCHED      // ENGINE_BUFFERED on up to BATCH_LANES ensemble replicas at once, one per vector lane
+} Engine;
+
+// What lies past the edges of the grid (the ghost cells)
+typedef enum {
+    BOUNDARY_REFLECT,   // Walls: off-grid cells are neither empty nor any species, so nothing moves or spawns there
+    BOUNDARY_TORUS      // Opposite edges are neighbours; the ghost cells are copies of them (buffered engine only)
+} Boundary;
+
+// Replicas per batch of the batched engine: one native vector of 16-bit values, so builds for a newer CPU
+// (e.g. -march=native) get wider batches
+#if defined(__AVX512BW__)
+#define BATCH_LANES 32
+#elif defined(__AVX2__)
+#define BATCH_LANES 16
+#else
+#define BATCH_LANES 8      // SSE2, NEON
+#endif
+
+// Backing of the grid planes
+typedef enum {
+    HUGE_PAGES_OFF,         // Regular pages
+    HUGE_PAGES_THP,         // Transparent huge pages (2 MiB-aligned blocks, madvise)
+    HUGE_PAGES_EXPLICIT     // Reserved huge pages (MAP_HUGETLB), falling back to THP
+} HugePages;
+
+// Instruction sets of the vectorised kernels
+typedef enum {
+    SIMD_AUTO,          // Widest one the CPU supports
+    SIMD_AVX2,
+    SIMD_SSE2,
+    SIMD_SCALAR
+} SimdLevel;
+
+// Simulation parameters
+typedef struct {
+    int rows;
+    int cols;
+    int plants;
+    int herbivores;
+    int carnivores;
+    int max_ticks;
+    int debug_tick;     // 0 disables the periodic grid dump
+    int reproduction;   // Chance (%) that a plant with an empty neighbour spawns into it
+    uint64_t seed;
+    Engine engine;
+    int tile;           // Tile side of the in-place engines, at least 2
+    SimdLevel simd;
+    bool bitboard;      // Keep species bitboards for counting and plant neighbourhoods
+    bool dirty_tiles;   // Skip the quiet tiles of the locked and tiles engines
+    bool plant_events;  // Event-driven plants in the sparse engine
+    Boundary boundary;  // What the ghost ring around the grid holds
+    char stats_path[256];   // Per-tick statistics CSV, empty to disable
+    char log_path[256];     // Per-tick population log
+    LogFormat log_format;
+    char snapshot_path[256];    // Binary grid snapshots instead of the printed grid, empty to disable
+    SnapshotEncoding snapshot_encoding;
+    char checkpoint_path[256];  // Periodic checkpoint, empty to disable
+    int checkpoint_every;       // Ticks between checkpoints
+    char resume_path[256];      // Checkpoint to continue from, empty to start from init_ecosystem
+    int workers;                // Strip worker processes, 1 runs the usual single-process engines
+    HugePages huge_pages;
+    bool pin;                   // Pin every OpenMP thread to one CPU and report where the tiles live
+    bool bench;                 // Print the ticks run and the seconds they took, for the benchmark driver
+    char trace_path[256];       // Per-phase trace, empty to disable (ECO_TRACE builds only)
+    TraceFormat trace_format;
+    bool deterministic;         // Same grid at every tick for any thread count (runs on a lock-free engine)
+    char hash_path[256];        // Per-tick state hashes, empty to disable
+    char hash_check_path[256];  // Reference hashes to compare every tick against, empty to disable
+    char ensemble_path[256];    // One replica per line of 'key=value' overrides, empty to disable
+    int replicas;               // Replicas of the base settings with consecutive seeds, 0 to disable
+    char ensemble_out[256];     // Per-replica tick statistics of an ensemble run
+} Config;
+
+// Plant row kernel: overpopulation and reproduction masks of one row (see plant_row_scalar)
+typedef void (*PlantRowKernel)(const uint8_t *up, const uint8_t *row, const uint8_t *down,
+                               uint8_t *out, int cols);
+
+// One bit plane per species (see bitboard_build_row)
+typedef struct {
+    int words;                 // 64-bit words per row, 0 when the bitboards are disabled
+    uint64_t *species[3];      // Indexed by PLANT, HERBIVORE and CARNIVORE, rows * words each
+} Bitboard;
+
+// Rules of one species. The animal kernels take them as a compile-time constant (see update_animal), so a
+// new species is a new table entry and a pair of one-line wrappers.
+typedef struct {
+    CellType prey;          // Eaten by moving onto it, EMPTY for none
+    CellType predator;      // Fled from, EMPTY for none
+    int starvation;         // Dies once starve exceeds this
+    int old_age;            // Inflection point of the death-by-age curve
+    int spawn_energy;       // Reproduces into an empty neighbour when energy exceeds this
+    int spawn_cost;         // Energy the parent gives to each newborn
+    int newborn_energy;
+    int freeze_chance;      // Percent chance of staying put next to a predator instead of fleeing
+} SpeciesRules;
+
+static const SpeciesRules SPECIES_RULES[3] = {
+    [PLANT] = {.prey = EMPTY, .predator = EMPTY, .newborn_energy = 1},
+    [HERBIVORE] = {.prey = PLANT, .predator = CARNIVORE, .starvation = STARVATION, .old_age = HERBIVORE_OLD,
+                   .spawn_energy = 2, .spawn_cost = 1, .newborn_energy = 1, .freeze_chance = 45},
+    [CARNIVORE] = {.prey = HERBIVORE, .predator = EMPTY, .starvation = STARVATION + 3, .old_age = CARNIVORE_OLD,
+                   .spawn_energy = 3, .spawn_cost = 2, .newborn_energy = 2},
+};
+
+#define AGE_STEEPNESS 2.0       // Steepness of the death-by-age curve
+#define AGE_LIMIT (UINT8_MAX + 2)   // Ages in the death-by-age tables (the buffered engine looks one tick ahead)
+
+// One thread's share of the tiles of a parallel phase, tasks [first, last) packed as first << 32 | last.
+// The owner takes from the front and thieves from the back, both with one CAS (see tiles_next).
+typedef struct {
+    _Alignas(STATS_CACHE_LINE) _Atomic uint64_t range;
+} TileDeque;
+
+// Per-thread output of the agent list rebuild (sparse engine)
+typedef struct {
+    _Alignas(STATS_CACHE_LINE) uint32_t *cells[3];
+    size_t count[3];
+    size_t capacity[3];
+} AgentBuffer;
+
+// Cell indices of every agent, one list per species (sparse engine)
+typedef struct {
+    uint32_t *cells[3];
+    size_t count[3];
+    size_t capacity[3];
+    uint8_t *listed;     // 1 for the cells in the lists, one byte per cell
+    AgentBuffer *found;  // One per thread
+    uint32_t *scratch;   // Radix sort buffer, swapped with the list it sorts
+    size_t scratch_capacity;
+    int threads;
+} AgentLists;
+
+// Quiet-tile tracking of the in-place engines (--dirty-tiles). A tile is settled when it holds no animal and
+// no plant that could die or spawn, whatever its draws: every plant has fewer than four plant neighbours and
+// no empty one. Whether it is only changes when something is written into the tile or next to it, so a tile
+// is only checked again after a sweep if it or one of the four tiles around it was written since its last
+// check (every change of a cell's type goes through set_cell, which stamps the cell's tile). A settled tile
+// that nobody has written near since is quiet: sweeping it would only count its plants, so the sweep adds the
+// counts saved by the check instead; the acted stamps left in it are from past ticks and never match.
+typedef struct {
+    int rows;                    // Tiles per column
+    int cols;                    // Tiles per row, 0 while the tracking is off
+    _Atomic uint64_t *touched;   // Tick + 1 of the last write into every tile, 0 if none
+    uint64_t *checked;           // Tick + 1 of the last check of every tile, 0 if none
+    bool *settled;               // What that check found
+    long long *plants;           // Plants of every settled tile
+    long long *energy;           // Their energy
+} DirtyTiles;
+
+#define PLANT_WHEEL_SLOTS 64   // Ticks of the plant timing wheel; later events wait in their slot for another turn
+#define PLANT_DORMANT UINT32_MAX   // Due tick of a plant that has nowhere to spawn (or never rolls)
+
+// Per-thread output of a tick of the plant events (sparse engine, --plant-events)
+typedef struct {
+    _Alignas(STATS_CACHE_LINE) uint32_t *born;   // Cells that got a new plant this tick
+    size_t count;
+    size_t capacity;
+    uint64_t *refile;   // Wheel entries to file again after the tick: the ones not due yet and the next rolls
+    size_t refile_count;
+    size_t refile_capacity;
+    uint32_t *emptied;  // Cells emptied this tick
+    size_t emptied_count;
+    size_t emptied_capacity;
+    long long plants;   // Change of the plants on the grid this tick
+    long long energy;   // And of their energy
+    bool failed;        // A list could not grow
+} PlantBuffer;
+
+// Event-driven plants of the sparse engine (--plant-events). A plant only does something when its reproduction
+// roll succeeds or when it gets four plant neighbours, so plants are left out of the agent lists. The tick of
+// every plant's next successful roll is drawn ahead, as a geometric gap, and the plant is filed in the slot of
+// that tick of a timing wheel; a tick only takes the entries of its own slot. Entries are `due << 32 | cell`,
+// and one only counts while the cell still holds a plant due at that tick. A plant only gets crowded when a
+// plant appears next to it, so the neighbours of every new plant are checked for overpopulation right away,
+// and the new plant itself at the start of the next tick, when the in-place engines would check it.
 typedef struct {
-    Cell grid[GRID_SIZE][GRID_SIZE];
-    omp_lock_t locks[GRID_SIZE][GRID_SIZE];
+    int threads;                            // 0 while the events are off
+    uint64_t *slot[PLANT_WHEEL_SLOTS];      // Entries filed for every tick modulo PLANT_WHEEL_SLOTS
+    size_t count[PLANT_WHEEL_SLOTS];
+    size_t capacity[PLANT_WHEEL_SLOTS];
+    uint64_t *scratch;                      // Second buffer of the slot sort
+    size_t scratch_capacity;
+    uint32_t *due;                          // Tick of the next successful roll of the plant on every cell
+    uint32_t *check;                        // Plants born last tick, checked for overpopulation
+    size_t check_count;
+    size_t check_capacity;
+    PlantBuffer *buffers;                   // One per thread
+    long long plants;                       // Plants on the grid at the start of the tick
+    long long energy;                       // Their energy
+} PlantEvents;
 
+// Ecosystem structure
+typedef struct {
+    int rows;
+    int cols;
+    int stride;          // Cells per row of every per-cell array: cols plus the two ghost columns
+    Boundary boundary;   // Walls, or a torus whose ghost cells the buffered engine refreshes every phase
+    Planes grid;         // rows * cols cells and their ghost ring, one aligned heap block per plane
+    omp_lock_t *locks;   // One lock per cell, same layout as grid (locked and sparse engines)
+    Planes back;         // Planes the next tick is written into (buffered engine only)
+    uint8_t *intent;     // Planned action of every cell (buffered engine only)
+    uint8_t *claim;      // Direction of the neighbour that takes every cell (buffered engine only)
+    uint8_t *plant_masks;   // One row of plant masks per thread, PLANT_MASK_STRIDE apart (buffered engine only)
+    Bitboard bits;       // Species bit planes (--bitboard only)
+    AgentLists agents;   // Agent index lists (sparse engine only)
+    DirtyTiles dirty;    // Quiet tiles of the in-place engines (--dirty-tiles only)
+    PlantEvents plant_events;   // Plant timing wheel of the sparse engine (--plant-events only)
+    uint64_t death_by_age[3][AGE_LIMIT];   // P(death by age) * 2^32 per species and age, see dies_of_age
+    Stats stats;         // Per-thread statistics of the current tick
+    Trace trace;         // Per-thread phase timers and lock counters (--trace, ECO_TRACE builds only)
+    TileDeque *deques;   // Work-stealing deques of the in-place engines, one per thread
+    int threads;         // Entries of deques
+    int tile;            // Tile side of the in-place engines
+    HugePages huge_pages;       // Backing of the grid planes
+    int huge_page_fallbacks;    // Blocks that got THP because no reserved huge pages were left
+    PlantRowKernel plant_kernel;
+    const char *plant_kernel_name;
+    uint64_t seed;       // Seed of the random streams
+    uint64_t tick;       // Current iteration, part of every random stream key
+    int row_offset;      // Global row of local row 0 (strip workers of --workers, 0 otherwise)
 } EcoSystem;
 
+// Cell index, field and lock access by (row, column). Rows -1 and rows and columns -1 and cols are the ghost
+// ring: every per-cell array starts `stride + 1` cells before cell (0, 0) (see plane_alloc), so ghost cells
+// have indices of their own, negative for the top row.
+#define AT(eco, i, j) ((ptrdiff_t) (i) * (eco)->stride + (j))
+#define TYPE(eco, i, j) ((eco)->grid.type[AT(eco, i, j)])
+#define ENERGY(eco, i, j) ((eco)->grid.energy[AT(eco, i, j)])
+#define AGE(eco, i, j) ((eco)->grid.age[AT(eco, i, j)])
+#define STARVE(eco, i, j) ((eco)->grid.starve[AT(eco, i, j)])
+#define ACTED(eco, i, j) ((eco)->grid.acted[AT(eco, i, j)] == (eco)->grid.epoch)
+#define LOCK(eco, i, j) (&(eco)->locks[AT(eco, i, j)])
+
+#define SATURATING_INCREMENT(field) ((field) += (field) < UINT8_MAX)
+#define EMPTY_X8 0x0303030303030303ULL   // Eight EMPTY bytes of the type plane
+#define OFF_GRID 0xFF                    // Type byte of the ghost cells of a reflecting boundary
+
+// Row and column offsets of the four directions: right, left, up, down as the update functions number them.
+// The opposite of direction d is d ^ 1.
+static const int DIRECTION_DI[4] = {1, -1, 0, 0};
+static const int DIRECTION_DJ[4] = {0, 0, 1, -1};
+
+// Function to allocate a zeroed, GRID_ALIGNMENT-aligned block
+void *aligned_calloc(size_t count, size_t size) {
+    size_t bytes = count * size;
+    bytes = (bytes + GRID_ALIGNMENT - 1) / GRID_ALIGNMENT * GRID_ALIGNMENT;
+
+    void *block = aligned_alloc(GRID_ALIGNMENT, bytes);
+    if (block != NULL) {
+        memset(block, 0, bytes);
+    }
+    return block;
+}
+
+// Counter-based random stream. Every (seed, tick, cell) triple gets its own
+// independent SplitMix64 sequence, so threads never share generator state.
+typedef struct {
+    uint64_t key;
+    uint64_t counter;
+} Rng;
+
+#define RNG_GAMMA 0x9e3779b97f4a7c15ULL
+#define RNG_INIT_TICK UINT64_MAX   // Stream tick used while placing the initial populations
+
+// SplitMix64 finaliser
+static inline uint64_t rng_mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// Function to open the stream of one cell at one tick
+static inline Rng rng_stream(uint64_t seed, uint64_t tick, uint64_t cell) {
+    uint64_t key = rng_mix(seed + RNG_GAMMA);
+    key = rng_mix(key ^ (tick + RNG_GAMMA));
+    key = rng_mix(key ^ (cell + RNG_GAMMA));
+    return (Rng){key, 0};
+}
+
+static inline uint64_t rng_next(Rng *rng) {
+    rng->counter += RNG_GAMMA;
+    return rng_mix(rng->key + rng->counter);
+}
+
+// Uniform integer in [0, bound)
+static inline int rng_below(Rng *rng, int bound) {
+    return (int) (((rng_next(rng) >> 32) * (uint64_t) bound) >> 32);
+}
+
+// Function to open the random stream of cell (i, j) for the current tick
+static inline Rng cell_rng(const EcoSystem *ecoSystem, int i, int j) {
+    return rng_stream(ecoSystem->seed, ecoSystem->tick, (uint64_t) (i + ecoSystem->row_offset) * ecoSystem->cols + j);
+}
+
+// Cell locking. Engines that never let two threads touch the same cell run without locks.
+static inline void lock_cell(EcoSystem *ecoSystem, int i, int j) {
+    if (ecoSystem->locks != NULL) trace_lock(&ecoSystem->trace, LOCK(ecoSystem, i, j));
+}
+
+static inline void unlock_cell(EcoSystem *ecoSystem, int i, int j) {
+    if (ecoSystem->locks != NULL) omp_unset_lock(LOCK(ecoSystem, i, j));
+}
+
+// Function to read cell c of a set of planes
+static inline Cell load_cell(const Planes *planes, ptrdiff_t c) {
+    return (Cell){planes->energy[c], planes->age[c], planes->starve[c],
+                  planes->acted != NULL && planes->acted[c] == planes->epoch, planes->type[c]};
+}
+
+// Function to write cell c of a set of planes, clamping every field to its plane
+static inline void store_cell(Planes *planes, ptrdiff_t c, Cell cell) {
+    planes->type[c] = (uint8_t) cell.type;
+    planes->energy[c] = (uint16_t) (cell.energy < 0 ? 0 : cell.energy > UINT16_MAX ? UINT16_MAX : cell.energy);
+    planes->age[c] = (uint8_t) (cell.age > UINT8_MAX ? UINT8_MAX : cell.age);
+    planes->starve[c] = (uint8_t) (cell.starve > UINT8_MAX ? UINT8_MAX : cell.starve);
+    if (planes->acted != NULL) planes->acted[c] = cell.acted ? planes->epoch : 0;
+}
+
+static inline Cell get_cell(const EcoSystem *ecoSystem, int i, int j) {
+    return load_cell(&ecoSystem->grid, AT(ecoSystem, i, j));
+}
+
+static bool agent_push(uint32_t **cells, size_t *count, size_t *capacity, uint32_t cell);
+
+// Function to write cell c when it held a plant, gets one or is emptied, keeping the plant totals and listing
+// the new plants and the emptied cells of the tick (--plant-events). A new plant is dormant until the end of
+// the tick schedules it, so wheel entries left by an earlier plant on the cell never fire for it.
+static void plant_store(EcoSystem *ecoSystem, size_t c, Cell cell) {
+    PlantBuffer *mine = &ecoSystem->plant_events.buffers[omp_get_thread_num()];
+    uint8_t was = ecoSystem->grid.type[c];
+    if (was == PLANT) {
+        mine->plants--;
+        mine->energy -= ecoSystem->grid.energy[c];
+    }
+    store_cell(&ecoSystem->grid, c, cell);
+    if (cell.type == PLANT) {
+        ecoSystem->plant_events.due[c] = PLANT_DORMANT;
+        mine->plants++;
+        mine->energy += ecoSystem->grid.energy[c];
+        mine->failed = !agent_push(&mine->born, &mine->count, &mine->capacity, (uint32_t) c) || mine->failed;
+    } else if (cell.type == EMPTY && was != EMPTY) {
+        mine->failed = !agent_push(&mine->emptied, &mine->emptied_count, &mine->emptied_capacity, (uint32_t) c)
+                       || mine->failed;
+    }
+}
+
+static inline void set_cell(EcoSystem *ecoSystem, int i, int j, Cell cell) {
+    size_t c = AT(ecoSystem, i, j);
+    if (ecoSystem->plant_events.threads > 0
+        && (ecoSystem->grid.type[c] == PLANT || cell.type == PLANT || cell.type == EMPTY)) {
+        plant_store(ecoSystem, c, cell);
+    } else {
+        store_cell(&ecoSystem->grid, c, cell);
+    }
+    DirtyTiles *dirty = &ecoSystem->dirty;
+    if (dirty->cols > 0) {
+        size_t t = (size_t) (i / ecoSystem->tile) * dirty->cols + j / ecoSystem->tile;
+        atomic_store_explicit(&dirty->touched[t], ecoSystem->tick + 1, memory_order_relaxed);
+    }
+}
+
+// Function to tell whether tile (r, c) or one of the tiles around it was written since its last check. Writes
+// in the tick of the check count, as they may have come after it.
+static inline bool tile_changed(const EcoSystem *ecoSystem, int r, int c) {
+    const DirtyTiles *dirty = &ecoSystem->dirty;
+    uint64_t checked = dirty->checked[(size_t) r * dirty->cols + c];
+    static const int AROUND_DR[5] = {0, 1, -1, 0, 0};
+    static const int AROUND_DC[5] = {0, 0, 0, 1, -1};
+
+    for (int d = 0; d < 5; d++) {
+        int x = r + AROUND_DR[d], y = c + AROUND_DC[d];
+        if (x < 0 || x >= dirty->rows || y < 0 || y >= dirty->cols) continue;
+        if (atomic_load_explicit(&dirty->touched[(size_t) x * dirty->cols + y], memory_order_relaxed) >= checked) {
+            return true;
+        }
+    }
+    return checked == 0;
+}
+
+// Function to tell whether tile (r, c) is quiet: settled, and nothing written into it or next to it since
+static inline bool tile_quiet(const EcoSystem *ecoSystem, int r, int c) {
+    return ecoSystem->dirty.settled[(size_t) r * ecoSystem->dirty.cols + c] && !tile_changed(ecoSystem, r, c);
+}
+
+// Function to check eight consecutive cells of the type plane for EMPTY at once
+static inline bool empty_x8(const uint8_t *type) {
+    uint64_t word;
+    memcpy(&word, type, sizeof(word));
+    return word == EMPTY_X8;
+}
+
 // Function to calculate the probability of death
 double death_probability(int age, double inflection_point, double steepness) {
     return 1.0 / (1.0 + exp(-(age - inflection_point) / steepness));
 }
 
-// Function to reset the acted flag
-void reset_acted(EcoSystem *ecoSystem){
-    for(int i = 0; i < GRID_SIZE; i++) {
-        for(int j = 0; j < GRID_SIZE; j++) {
-            omp_set_lock(&ecoSystem->locks[i][j]);
-            ecoSystem->grid[i][j].acted = false;
-            omp_unset_lock(&ecoSystem->locks[i][j]);
+// Function to fill the death-by-age tables, so the hot loop never calls exp()
+void death_by_age_init(EcoSystem *ecoSystem) {
+    for (int s = HERBIVORE; s <= CARNIVORE; s++) {
+        for (int age = 0; age < AGE_LIMIT; age++) {
+            double p = death_probability(age, SPECIES_RULES[s].old_age, AGE_STEEPNESS);
+            ecoSystem->death_by_age[s][age] = (uint64_t) ldexp(p, 32);
         }
     }
 }
 
+// Function to draw death by age: one 32-bit draw against the integer threshold
+static inline bool dies_of_age(const EcoSystem *ecoSystem, Rng *rng, CellType species, int age) {
+    return (rng_next(rng) >> 32) < ecoSystem->death_by_age[species][age];
+}
+
+// Function to start the acted epoch of the current tick. An agent has acted this tick when its stamp equals
+// the epoch, so every stamp of the last tick goes stale at once without touching the grid. Only when the
+// epoch wraps, once every ACTED_EPOCHS ticks, are the stamps cleared, lock-free since no sweep is running.
+void begin_acted(EcoSystem *ecoSystem) {
+    uint16_t epoch = (uint16_t) (ecoSystem->tick % ACTED_EPOCHS + 1);
+    if (epoch < ecoSystem->grid.epoch) {
+        trace_begin(&ecoSystem->trace, PHASE_RESET);
+        size_t plane = (size_t) (ecoSystem->rows + 2) * ecoSystem->stride;
+        memset(ecoSystem->grid.acted - (ecoSystem->stride + 1), 0, plane * sizeof(uint16_t));
+        trace_end(&ecoSystem->trace, PHASE_RESET);
+    }
+    ecoSystem->grid.epoch = epoch;
+}
+
 // Function to update the plant
 void update_plant(EcoSystem *ecoSystem, int reproduction_chance, int i, int j) {
-    if (ecoSystem->grid[i][j].acted) {
+    if (ACTED(ecoSystem, i, j)) {
         return;
     }
 
-    omp_set_lock(&ecoSystem->locks[i][j]);
-    ecoSystem->grid[i][j].acted = true;
-    omp_unset_lock(&ecoSystem->locks[i][j]);
-
+    lock_cell(ecoSystem, i, j);
+    ecoSystem->grid.acted[AT(ecoSystem, i, j)] = ecoSystem->grid.epoch;
+    unlock_cell(ecoSystem, i, j);
 
-    // Death by overpopulation
-    int neighbors = 0;
+    Rng rng = cell_rng(ecoSystem, i, j);
+    TickStats *stats = stats_local(&ecoSystem->stats);
+    stats->population[PLANT]++;
+    stats->energy[PLANT] += ENERGY(ecoSystem, i, j);
 
-    if (i + 1 < GRID_SIZE && ecoSystem->grid[i + 1][j].type == PLANT) neighbors++;
-    if (i - 1 >= 0 && ecoSystem->grid[i - 1][j].type == PLANT) neighbors++;
-    if (j + 1 < GRID_SIZE && ecoSystem->grid[i][j + 1].type == PLANT) neighbors++;
-    if (j - 1 >= 0 && ecoSystem->grid[i][j - 1].type == PLANT) neighbors++;
+    // Death by overpopulation (ghost cells are never plants)
+    int neighbors = (TYPE(ecoSystem, i + 1, j) == PLANT) + (TYPE(ecoSystem, i - 1, j) == PLANT)
+                    + (TYPE(ecoSystem, i, j + 1) == PLANT) + (TYPE(ecoSystem, i, j - 1) == PLANT);
 
     if (neighbors > 3) {
-        omp_set_lock(&ecoSystem->locks[i][j]);
-        ecoSystem->grid[i][j] = (Cell){0, 0, 0, false, EMPTY};  // The plant dies
-        omp_unset_lock(&ecoSystem->locks[i][j]);
+        lock_cell(ecoSystem, i, j);
+        set_cell(ecoSystem, i, j, (Cell){0, 0, 0, false, EMPTY});  // The plant dies
+        unlock_cell(ecoSystem, i, j);
+        stats->deaths[PLANT][DEATH_OVERPOPULATION]++;
 
         return;
     }
 
-    // Reproduction
-    int direction = rand() % 4;
-    int x = i, y = j;
-
-    switch(direction) {
-        case 0:  // right
-            if (i + 1 < GRID_SIZE) x = i + 1;
-            break;
-        case 1: // left
-            if (i - 1 >= 0) x = i - 1;
-            break;
-        case 2: // up
-            if (j + 1 < GRID_SIZE) y = j + 1;
-            break;
-        case 3: //
-            if (j - 1 >= 0) y = j - 1;
-            break;
-        default:
-            break;
-    }
+    // Reproduction; a ghost cell is never empty, so nothing spawns off the grid
+    int direction = rng_below(&rng, 4);
+    int x = i + DIRECTION_DI[direction], y = j + DIRECTION_DJ[direction];
 
     // Cell is empty and the reproduction chance is greater that reproduction probability
-    if (ecoSystem->grid[x][y].type == EMPTY && (rand() % 100) < reproduction_chance) {
-        omp_set_lock(&ecoSystem->locks[x][y]);
-        ecoSystem->grid[x][y] = (Cell){1, 0, 0, true, PLANT};  // New plant is born
-        omp_unset_lock(&ecoSystem->locks[x][y]);
+    if (TYPE(ecoSystem, x, y) == EMPTY && rng_below(&rng, 100) < reproduction_chance) {
+        lock_cell(ecoSystem, x, y);
+        set_cell(ecoSystem, x, y, (Cell){SPECIES_RULES[PLANT].newborn_energy, 0, 0, true, PLANT});  // New plant is born
+        unlock_cell(ecoSystem, x, y);
+        stats->births[PLANT]++;
 
     }
 }
 
-// Function to update the herbivore
-void update_herbivore(EcoSystem *ecoSystem, int i, int j) {
+// Function to update the animal at (i, j) by the rules of its species. Always inlined with a constant
+// `species`, so update_herbivore and update_carnivore get every rule folded into their code.
+static inline __attribute__((always_inline)) void update_animal(EcoSystem *ecoSystem, int i, int j, CellType species) {
+    const SpeciesRules *rules = &SPECIES_RULES[species];
 
-        if (ecoSystem->grid[i][j].acted) {
-            return;
-        }
+    if (ACTED(ecoSystem, i, j)) {
+        return;
+    }
 
-        omp_set_lock(&ecoSystem->locks[i][j]);
-        ecoSystem->grid[i][j].acted = true;
-        omp_unset_lock(&ecoSystem->locks[i][j]);
+    lock_cell(ecoSystem, i, j);
+    ecoSystem->grid.acted[AT(ecoSystem, i, j)] = ecoSystem->grid.epoch;
+    unlock_cell(ecoSystem, i, j);
 
-        // Death by starvation
-        if (ecoSystem->grid[i][j].starve > STARVATION) {
-            omp_set_lock(&ecoSystem->locks[i][j]);
-//            printf("Herbivore died by starvation\n");
-            ecoSystem->grid[i][j] = (Cell){0, 0, 0, false, EMPTY};  // The herbivore dies
-            omp_unset_lock(&ecoSystem->locks[i][j]);
+    Rng rng = cell_rng(ecoSystem, i, j);
+    TickStats *stats = stats_local(&ecoSystem->stats);
+    stats->population[species]++;
+    stats->energy[species] += ENERGY(ecoSystem, i, j);
 
-            return;
-        }
+    // Death by starvation
+    if (STARVE(ecoSystem, i, j) > rules->starvation) {
+        lock_cell(ecoSystem, i, j);
+        set_cell(ecoSystem, i, j, (Cell){0, 0, 0, false, EMPTY});  // The animal dies
+        unlock_cell(ecoSystem, i, j);
+        stats->deaths[species][DEATH_STARVATION]++;
+
+        return;
+    }
 
-        ecoSystem -> grid[i][j].age += 1;
+    lock_cell(ecoSystem, i, j);
+    SATURATING_INCREMENT(AGE(ecoSystem, i, j));
+    unlock_cell(ecoSystem, i, j);
 
-        // Death by age
-        double death_by_age = death_probability(ecoSystem->grid[i][j].age, HERBIVORE_OLD, 2);
-        double r = (double) rand() / RAND_MAX;
-        if (r < death_by_age) {
-            omp_set_lock(&ecoSystem->locks[i][j]);
-//            printf("Herbivore died by age\n");
-            ecoSystem->grid[i][j] = (Cell){0, 0, 0, false, EMPTY}; // The herbivore dies
-            omp_unset_lock(&ecoSystem->locks[i][j]);
+    // Death by age
+    if (dies_of_age(ecoSystem, &rng, species, AGE(ecoSystem, i, j))) {
+        lock_cell(ecoSystem, i, j);
+        set_cell(ecoSystem, i, j, (Cell){0, 0, 0, false, EMPTY}); // The animal dies
+        unlock_cell(ecoSystem, i, j);
+        stats->deaths[species][DEATH_AGE]++;
 
-            return;
-        }
+        return;
+    }
 
-        // Movement
-        int direction = rand() % 4;
-        int x = i, y = j;
+    // Movement; a ghost cell is neither prey, empty nor a predator, so the animal stays
+    int direction = rng_below(&rng, 4);
+    int x = i + DIRECTION_DI[direction], y = j + DIRECTION_DJ[direction];
 
-        switch(direction) {
-            case 0:  // right
-                if (i + 1 < GRID_SIZE) x = i + 1;
-                break;
-            case 1: // left
-                if (i - 1 >= 0) x = i - 1;
-                break;
-            case 2: // up
-                if (j + 1 < GRID_SIZE) y = j + 1;
-                break;
-            case 3: //
-                if (j - 1 >= 0) y = j - 1;
-                break;
-            default:
-                break;
-        }
+    if (TYPE(ecoSystem, x, y) == rules->prey) {
+        // Finds its prey and eats it
+        lock_cell(ecoSystem, x, y);
+        lock_cell(ecoSystem, i, j);
 
-        if ( ecoSystem -> grid[x][y].type == PLANT){
-            // Finds a plant and eats it
-            omp_set_lock(&ecoSystem->locks[x][y]);
-            omp_set_lock(&ecoSystem->locks[i][j]);
+        int e = ENERGY(ecoSystem, x, y);  // Energy of the prey
 
-            int e = ecoSystem -> grid[x][y].energy;  // Energy of the plant
+        set_cell(ecoSystem, x, y, (Cell){ENERGY(ecoSystem, i, j) + e, AGE(ecoSystem, i, j), 0, true, species});
+        set_cell(ecoSystem, i, j, (Cell){0, 0, 0, false, EMPTY}); // The animal moves to the prey cell
 
-            ecoSystem -> grid[x][y] = (Cell){ecoSystem -> grid[i][j].energy + e, ecoSystem -> grid[i][j].age, 0, true, HERBIVORE};
-            ecoSystem -> grid[i][j] = (Cell){0, 0, 0, false, EMPTY}; // The herbivore moves to the plant cell
+        unlock_cell(ecoSystem, x, y);
+        unlock_cell(ecoSystem, i, j);
+        stats->deaths[rules->prey][DEATH_PREDATION]++;
+        stats->moves[species]++;
 
-            omp_unset_lock(&ecoSystem->locks[x][y]);
-            omp_unset_lock(&ecoSystem->locks[i][j]);
+    } else if (TYPE(ecoSystem, x, y) == EMPTY) {
+        lock_cell(ecoSystem, x, y);
+        lock_cell(ecoSystem, i, j);
 
-        } else if (ecoSystem -> grid[x][y].type == EMPTY){
-            omp_set_lock(&ecoSystem->locks[x][y]);
-            omp_set_lock(&ecoSystem->locks[i][j]);
+        SATURATING_INCREMENT(STARVE(ecoSystem, i, j));
 
-            ecoSystem -> grid[i][j].starve += 1;
+        if (ENERGY(ecoSystem, i, j) > rules->spawn_energy) {  // Reproduction
+            set_cell(ecoSystem, x, y, (Cell){rules->newborn_energy, 0, 0, false, species}); // New animal is born
+            ENERGY(ecoSystem, i, j) -= rules->spawn_cost;
+            stats->births[species]++;
 
-            if (ecoSystem -> grid[i][j].energy > 2) {  // Reproduction
+        } else {  // Move to the empty cell
+            set_cell(ecoSystem, x, y, get_cell(ecoSystem, i, j));
+            set_cell(ecoSystem, i, j, (Cell){0, 0, 0, false, EMPTY}); // The animal moves to the empty cell
+            stats->moves[species]++;
+        }
 
-                ecoSystem -> grid[x][y] = (Cell){1, 0, 0, false, HERBIVORE}; // New herbivore is born
-                ecoSystem -> grid[i][j].energy -= 1;
+        unlock_cell(ecoSystem, i, j);
+        unlock_cell(ecoSystem, x, y);
 
+    } else if (rules->predator != EMPTY && TYPE(ecoSystem, x, y) == rules->predator) {
+        if (rng_below(&rng, 100) < rules->freeze_chance) {
+            SATURATING_INCREMENT(STARVE(ecoSystem, i, j));
+            return;
+        }
 
-            } else {  // Move to the empty cell
-                ecoSystem -> grid[x][y] = ecoSystem -> grid[i][j];
-                ecoSystem -> grid[i][j] = (Cell){0, 0, 0, false, EMPTY}; // The herbivore moves to the empty cell
+        // Move away from the predator
+        x = i + DIRECTION_DI[direction ^ 1];
+        y = j + DIRECTION_DJ[direction ^ 1];
 
-            }
+        if (TYPE(ecoSystem, x, y) == EMPTY) {
+            lock_cell(ecoSystem, x, y);
+            lock_cell(ecoSystem, i, j);
+            set_cell(ecoSystem, x, y, get_cell(ecoSystem, i, j));
+            set_cell(ecoSystem, i, j, (Cell){0, 0, 0, true, EMPTY}); // The animal flees to the empty cell
+            unlock_cell(ecoSystem, x, y);
+            unlock_cell(ecoSystem, i, j);
+            stats->moves[species]++;
+        }
+    }
+}
+
+// Function to update the herbivore
+void update_herbivore(EcoSystem *ecoSystem, int i, int j) {
+    update_animal(ecoSystem, i, j, HERBIVORE);
+}
+
+// Function to update the carnivore
+void update_carnivore(EcoSystem *ecoSystem, int i, int j) {
+    update_animal(ecoSystem, i, j, CARNIVORE);
+}
 
-            omp_unset_lock(&ecoSystem->locks[i][j]);
-            omp_unset_lock(&ecoSystem->locks[x][y]);
+// ---------------------------------------------------------------------------
+// Work-stealing tile scheduler
+//
+// A parallel phase of the in-place engines is a fixed set of tiles, numbered
+// so that consecutive tasks are neighbouring tiles. At the start of the phase
+// every thread of the team gets a contiguous block of tasks in its deque. It
+// works through its own block from the front and, once that is empty, steals
+// single tiles from the back of the other blocks, so threads that drew quiet
+// parts of the world help the ones that drew crowded parts. No task is ever
+// added during a phase, so a thread that finds every deque empty is done.
+// Which tiles may run concurrently is up to the caller: the tiles engine only
+// puts tiles of one colour in a phase.
+// ---------------------------------------------------------------------------
 
-        } else if (ecoSystem -> grid[x][y].type == CARNIVORE){
+#define DEQUE_RANGE(first, last) (((uint64_t) (first) << 32) | (uint32_t) (last))
 
-            if (rand() % 100 < 45) {
-                ecoSystem -> grid[i][j].starve += 1;
-                return;
-            }
+// Function to split tasks [0, count) into contiguous blocks, one per thread of the team
+static void tiles_deal(EcoSystem *ecoSystem, int threads, int count) {
+    for (int t = 0; t < threads; t++) {
+        int first = (int) ((long long) count * t / threads);
+        int last = (int) ((long long) count * (t + 1) / threads);
+        atomic_store_explicit(&ecoSystem->deques[t].range, DEQUE_RANGE(first, last), memory_order_relaxed);
+    }
+}
 
+// Function to take one task from the front (own deque) or the back (stealing); -1 if the deque is empty
+static inline int deque_take(TileDeque *deque, bool front) {
+    uint64_t range = atomic_load_explicit(&deque->range, memory_order_relaxed);
 
-            // Move if there is a predator
-            switch (direction) {
-                case 0:  // Carnivore is to the right, move to the left
-                    if (i - 1 >= 0) x = i - 1;
-                    break;
-                case 1: // Carnivore is to the left, move to the right
-                    if (i + 1 < GRID_SIZE) x = i + 1;
+    for (;;) {
+        uint32_t first = (uint32_t) (range >> 32), last = (uint32_t) range;
+        if (first >= last) return -1;
+
+        uint64_t taken = front ? DEQUE_RANGE(first + 1, last) : DEQUE_RANGE(first, last - 1);
+        if (atomic_compare_exchange_weak_explicit(&deque->range, &range, taken,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+            return (int) (front ? first : last - 1);
+        }
+    }
+}
+
+// Function to get the next task of thread `self`: its own tiles first, then stolen ones; -1 when the phase is done
+static inline int tiles_next(EcoSystem *ecoSystem, int self, int threads) {
+    int task = deque_take(&ecoSystem->deques[self], true);
+
+    for (int v = 1; task < 0 && v < threads; v++) {
+        task = deque_take(&ecoSystem->deques[(self + v) % threads], false);
+    }
+    return task;
+}
+
+// Function to update the agents of cells [row, row_end) x [col, col_end) in place
+static inline void update_block(EcoSystem *ecoSystem, int reproduction_chance, int row, int row_end, int col, int col_end) {
+    for (int t = row; t < row_end; t++) {
+        for (int k = col; k < col_end; k++) {
+            if (k + 8 <= col_end && empty_x8(&TYPE(ecoSystem, t, k))) {
+                k += 7;  // Nothing to do for a run of empty cells
+                continue;
+            }
+            switch (TYPE(ecoSystem, t, k)) {
+                case EMPTY:
                     break;
-                case 2: // Carnivore is up, move down
-                    if (j - 1 >= 0) y = j - 1;
+                case PLANT:
+                    update_plant(ecoSystem, reproduction_chance, t, k);
                     break;
-                case 3: // Carnivore is down, move up
-                    if (j + 1 < GRID_SIZE) y = j + 1;
+                case HERBIVORE:
+                    update_herbivore(ecoSystem, t, k);
                     break;
-                default:
+                case CARNIVORE:
+                    update_carnivore(ecoSystem, t, k);
                     break;
             }
-
-            if (ecoSystem -> grid[x][y].type == EMPTY) {
-                omp_set_lock(&ecoSystem->locks[x][y]);
-                omp_set_lock(&ecoSystem->locks[i][j]);
-                ecoSystem->grid[x][y] = ecoSystem->grid[i][j];
-                ecoSystem->grid[i][j] = (Cell){0, 0, 0, true, EMPTY}; // The herbivore moves to the empty cell
-                omp_unset_lock(&ecoSystem->locks[x][y]);
-                omp_unset_lock(&ecoSystem->locks[i][j]);
-
-            }
         }
+    }
 }
 
-// Function to update the carnivore
-void update_carnivore(EcoSystem *ecoSystem, int i, int j){
-        if (ecoSystem->grid[i][j].acted) {
-            return;
-        }
+// Function to check, after its sweep, whether tile (r, c) of cells [row, row_end) x [col, col_end) has settled
+// (see DirtyTiles); a settled tile gets its plant counts saved
+static void tile_check(EcoSystem *ecoSystem, int r, int c, int row, int row_end, int col, int col_end) {
+    DirtyTiles *dirty = &ecoSystem->dirty;
+    size_t t = (size_t) r * dirty->cols + c;
+    if (!tile_changed(ecoSystem, r, c)) {
+        return;  // Still what the last check found: not settled, or the tile would not have been swept
+    }
+    if (atomic_load_explicit(&dirty->touched[t], memory_order_relaxed) > ecoSystem->tick) {
+        return;  // Written this tick: not quiet next tick anyway, check once it is left alone
+    }
+    dirty->checked[t] = ecoSystem->tick + 1;
+    dirty->settled[t] = false;
 
-        ecoSystem->grid[i][j].acted = true;
+    long long plants = 0, energy = 0;
+    for (int i = row; i < row_end; i++) {
+        for (int j = col; j < col_end; j++) {
+            if (j + 8 <= col_end && empty_x8(&TYPE(ecoSystem, i, j))) {
+                j += 7;  // Nothing to check in a run of empty cells
+                continue;
+            }
+            if (TYPE(ecoSystem, i, j) == EMPTY) continue;
+            if (TYPE(ecoSystem, i, j) != PLANT) return;
 
-        // Death by starvation
-        if (ecoSystem->grid[i][j].starve > STARVATION + 3) {
-            omp_set_lock(&ecoSystem->locks[i][j]);
-            ecoSystem->grid[i][j] = (Cell){0, 0, 0, false, EMPTY};  // The herbivore dies
-            omp_unset_lock(&ecoSystem->locks[i][j]);
+            uint8_t around[4] = {TYPE(ecoSystem, i + 1, j), TYPE(ecoSystem, i - 1, j),
+                                 TYPE(ecoSystem, i, j + 1), TYPE(ecoSystem, i, j - 1)};
+            int neighbors = (around[0] == PLANT) + (around[1] == PLANT) + (around[2] == PLANT) + (around[3] == PLANT);
+            bool room = around[0] == EMPTY || around[1] == EMPTY || around[2] == EMPTY || around[3] == EMPTY;
+            if (neighbors > 3 || room) return;
 
-            return;
+            plants++;
+            energy += ENERGY(ecoSystem, i, j);
         }
+    }
 
-        omp_set_lock(&ecoSystem->locks[i][j]);
-        ecoSystem -> grid[i][j].age += 1;
-        omp_unset_lock(&ecoSystem->locks[i][j]);
+    dirty->plants[t] = plants;
+    dirty->energy[t] = energy;
+    dirty->settled[t] = true;
+}
 
-    // Death by age
-        double death_by_age = death_probability(ecoSystem->grid[i][j].age, CARNIVORE_OLD, 2);
-        if (rand() % 100 < death_by_age * 100) {
+// Function to update the agents of one tile of the in-place engines, cells [row, row_end) x [col, col_end)
+// with row and col multiples of the tile side. A quiet tile only adds the plants it saved (--dirty-tiles).
+// Returns whether the tile was swept.
+static inline bool update_tile(EcoSystem *ecoSystem, int reproduction_chance, int row, int row_end, int col, int col_end) {
+    if (ecoSystem->dirty.cols == 0) {
+        update_block(ecoSystem, reproduction_chance, row, row_end, col, col_end);
+        return true;
+    }
 
-            omp_set_lock(&ecoSystem->locks[i][j]);
-            ecoSystem->grid[i][j] = (Cell){0, 0, 0, false, EMPTY}; // The herbivore dies
-            omp_unset_lock(&ecoSystem->locks[i][j]);
+    int r = row / ecoSystem->tile, c = col / ecoSystem->tile;
+    if (tile_quiet(ecoSystem, r, c)) {
+        size_t t = (size_t) r * ecoSystem->dirty.cols + c;
+        TickStats *stats = stats_local(&ecoSystem->stats);
+        stats->population[PLANT] += ecoSystem->dirty.plants[t];
+        stats->energy[PLANT] += ecoSystem->dirty.energy[t];
+        return false;
+    }
+    update_block(ecoSystem, reproduction_chance, row, row_end, col, col_end);
+    tile_check(ecoSystem, r, c, row, row_end, col, col_end);
+    return true;
+}
 
-            return;
-        }
+// Function to update the agents of rows [from, to) in place, in parallel under the cell locks
+void update_rows(EcoSystem *ecoSystem, int reproduction_chance, int from, int to) {
+    int tile = ecoSystem->tile;
+    int tile_rows = (to - from + tile - 1) / tile;
+    int tile_cols = (ecoSystem->cols + tile - 1) / tile;
 
-        int direction = rand() % 4;
-        int x = i, y = j;
+    #pragma omp parallel
+    {
+        trace_begin(&ecoSystem->trace, PHASE_SWEEP);
+        int threads = omp_get_num_threads();
+        #pragma omp single
+        tiles_deal(ecoSystem, threads, tile_rows * tile_cols);
 
-        switch(direction) {
-            case 0:  // right
-                if (i + 1 < GRID_SIZE) x = i + 1;
-                break;
-            case 1: // left
-                if (i - 1 >= 0) x = i - 1;
-                break;
-            case 2: // up
-                if (j + 1 < GRID_SIZE) y = j + 1;
-                break;
-            case 3: //
-                if (j - 1 >= 0) y = j - 1;
-                break;
-            default:
-                break;
+        int task;
+        while ((task = tiles_next(ecoSystem, omp_get_thread_num(), threads)) >= 0) {
+            int row = from + task / tile_cols * tile, col = task % tile_cols * tile;
+            int row_end = row + tile < to ? row + tile : to;
+            int col_end = col + tile < ecoSystem->cols ? col + tile : ecoSystem->cols;
+            if (update_tile(ecoSystem, reproduction_chance, row, row_end, col, col_end)) {
+                trace_cells(&ecoSystem->trace, (long long) (row_end - row) * (col_end - col));
+            }
         }
+        trace_end(&ecoSystem->trace, PHASE_SWEEP);
+    }
+}
+
+// Function to advance the locked engine by one tick
+void step_locked(EcoSystem *ecoSystem, int reproduction_chance) {
+    begin_acted(ecoSystem);
+    update_rows(ecoSystem, reproduction_chance, 0, ecoSystem->rows);
+}
+
+// Function to advance the tiles engine by one tick.
+//
+// An agent only reads and writes cells at distance 1, so two agents at least
+// 3 cells apart never touch the same cell. The grid is cut into tile x tile
+// squares coloured like a 2x2 checkerboard of tiles; tiles of one colour are
+// then at least `tile` >= 2 cells apart and a whole colour can be updated in
+// parallel, in place, without locks. The four colours run one after another,
+// so every cell is still visited exactly once per tick. Each colour is one
+// phase of the work-stealing scheduler.
+void step_tiles(EcoSystem *ecoSystem, int reproduction_chance) {
+    begin_acted(ecoSystem);
+    int tile = ecoSystem->tile;
+    int tile_rows = (ecoSystem->rows + tile - 1) / tile;
+    int tile_cols = (ecoSystem->cols + tile - 1) / tile;
 
-        if(ecoSystem->grid[x][y].type == HERBIVORE){
-           // Carnivore eats herbivore
-           int e = ecoSystem -> grid[x][y].energy;  // Energy of the herbivore
-            omp_set_lock(&ecoSystem->locks[x][y]);
-            omp_set_lock(&ecoSystem->locks[i][j]);
+    for (int colour = 0; colour < 4; colour++) {
+        // Tiles (colour >> 1 + 2 * r, colour & 1 + 2 * c) of this colour, numbered row-major
+        int colour_rows = (tile_rows - (colour >> 1) + 1) / 2;
+        int colour_cols = (tile_cols - (colour & 1) + 1) / 2;
 
-            ecoSystem -> grid[x][y] = (Cell){ecoSystem -> grid[i][j].energy + e, ecoSystem -> grid[i][j].age, 0, true, CARNIVORE};
-            ecoSystem -> grid[i][j] = (Cell){0, 0, 0, false, EMPTY}; // The carnivore moves to the herbivore cell
+        #pragma omp parallel
+        {
+            trace_begin(&ecoSystem->trace, PHASE_SWEEP);
+            int threads = omp_get_num_threads();
+            #pragma omp single
+            tiles_deal(ecoSystem, threads, colour_rows * colour_cols);
 
-            omp_unset_lock(&ecoSystem->locks[x][y]);
-            omp_unset_lock(&ecoSystem->locks[i][j]);
+            int task;
+            while ((task = tiles_next(ecoSystem, omp_get_thread_num(), threads)) >= 0) {
+                int row = ((colour >> 1) + 2 * (task / colour_cols)) * tile;
+                int col = ((colour & 1) + 2 * (task % colour_cols)) * tile;
+                int row_end = row + tile < ecoSystem->rows ? row + tile : ecoSystem->rows;
+                int col_end = col + tile < ecoSystem->cols ? col + tile : ecoSystem->cols;
+                if (update_tile(ecoSystem, reproduction_chance, row, row_end, col, col_end)) {
+                    trace_cells(&ecoSystem->trace, (long long) (row_end - row) * (col_end - col));
+                }
+            }
+            trace_end(&ecoSystem->trace, PHASE_SWEEP);
+        }
+    }
+}
 
-        //printf("Carnivore ate herbivore\n");
-        } else if (ecoSystem -> grid[x][y].type == EMPTY){
-            ecoSystem -> grid[i][j].starve += 1;
+// ---------------------------------------------------------------------------
+// Sparse engine
+//
+// Runs the same locked update functions as step_locked, but only over lists of
+// the cells that hold an agent, so a tick costs O(agents) instead of
+// O(rows * cols). Everything an agent does in a tick - moving, fleeing, eating,
+// giving birth - lands on a neighbour at distance 1, and whatever acts stands on
+// a listed cell, so after the tick every agent is on a listed cell or next to
+// one. The lists are rebuilt from those candidates, each occupied cell once,
+// and sorted by cell: the agents act in list order, so the lists must come out
+// the same whatever the thread count or history, as after a checkpoint scan.
+// ---------------------------------------------------------------------------
 
-            // Reproduction
-            if (ecoSystem -> grid[i][j].energy > 3) {
-                omp_set_lock(&ecoSystem->locks[x][y]);
-                omp_set_lock(&ecoSystem->locks[i][j]);
+#define AGENT_SORT_BITS 11   // Cell index bits per pass of the list sort (2048 counters)
 
-                ecoSystem->grid[x][y] = (Cell){2, 0, 0, false, CARNIVORE}; // New carnivore is born
-                ecoSystem -> grid[i][j].energy -= 2;
+// Function to append a cell to a growable index list
+static bool agent_push(uint32_t **cells, size_t *count, size_t *capacity, uint32_t cell) {
+    if (*count == *capacity) {
+        size_t grown = *capacity > 0 ? *capacity * 2 : 1024;
+        uint32_t *resized = realloc(*cells, grown * sizeof(uint32_t));
+        if (resized == NULL) return false;
+        *cells = resized;
+        *capacity = grown;
+    }
+    (*cells)[(*count)++] = cell;
+    return true;
+}
 
-                omp_unset_lock(&ecoSystem->locks[x][y]);
-                omp_unset_lock(&ecoSystem->locks[i][j]);
+// Function to list every agent of the grid, after init_ecosystem or a checkpoint. The lists hold AT indices.
+int agent_lists_scan(EcoSystem *ecoSystem) {
+    AgentLists *agents = &ecoSystem->agents;
+    bool plants = ecoSystem->plant_events.threads == 0;   // Event-driven plants are not listed
 
-            } else {
-                // Carnivore moves to the empty cell
-                omp_set_lock(&ecoSystem->locks[x][y]);
-                omp_set_lock(&ecoSystem->locks[i][j]);
-                ecoSystem -> grid[x][y] = ecoSystem -> grid[i][j];
-                ecoSystem -> grid[i][j] = (Cell){0, 0, 0, false, EMPTY}; // The carnivore moves to the empty cell
-                omp_unset_lock(&ecoSystem->locks[x][y]);
-                omp_unset_lock(&ecoSystem->locks[i][j]);
+    for (int i = 0; i < ecoSystem->rows; i++) {
+        for (int j = 0; j < ecoSystem->cols; j++) {
+            size_t c = AT(ecoSystem, i, j);
+            uint8_t type = ecoSystem->grid.type[c];
+            agents->listed[c] = type != EMPTY && (plants || type != PLANT);
+            if (agents->listed[c]
+                && !agent_push(&agents->cells[type], &agents->count[type], &agents->capacity[type], (uint32_t) c)) {
+                return -1;
             }
         }
+    }
+    return 0;
 }
 
-// Function to initialize the ecosystem
-void init_ecosystem(EcoSystem *ecoSystem) {
+// Function to sort list s by cell, with an LSD radix sort of AGENT_SORT_BITS per pass, into the row-major
+// order agent_lists_scan lists the agents in
+static bool agent_sort(AgentLists *agents, int s, size_t cells) {
+    size_t count = agents->count[s];
+    if (agents->scratch_capacity < agents->capacity[s]) {
+        uint32_t *resized = realloc(agents->scratch, agents->capacity[s] * sizeof(uint32_t));
+        if (resized == NULL) return false;
+        agents->scratch = resized;
+        agents->scratch_capacity = agents->capacity[s];
+    }
 
-    // initialize the grid with empty cells
-    #pragma parallel for schedule(dynamic)
-    for(int i = 0; i < GRID_SIZE; i++) {
-        for(int j = 0; j < GRID_SIZE; j++) {
-            ecoSystem->grid[i][j].type = EMPTY;
-            ecoSystem->grid[i][j].energy = 0;
-            ecoSystem->grid[i][j].age = 0;
-            ecoSystem->grid[i][j].starve = 0;
-            ecoSystem->grid[i][j].acted = false;
-            omp_init_lock(&ecoSystem->locks[i][j]);
+    for (int shift = 0; shift < 32 && (uint64_t) (cells - 1) >> shift > 0; shift += AGENT_SORT_BITS) {
+        size_t start[1 << AGENT_SORT_BITS] = {0};
+        const uint32_t *from = agents->cells[s];
+        for (size_t k = 0; k < count; k++) {
+            start[(from[k] >> shift) & ((1 << AGENT_SORT_BITS) - 1)]++;
+        }
+        for (size_t d = 0, sum = 0; d < (1 << AGENT_SORT_BITS); d++) {
+            size_t digits = start[d];
+            start[d] = sum;
+            sum += digits;
+        }
+        for (size_t k = 0; k < count; k++) {
+            agents->scratch[start[(from[k] >> shift) & ((1 << AGENT_SORT_BITS) - 1)]++] = from[k];
         }
-    }
 
-    #pragma barrier
+        // The sorted copy becomes the list
+        uint32_t *swapped = agents->cells[s];
+        size_t swapped_capacity = agents->capacity[s];
+        agents->cells[s] = agents->scratch;
+        agents->capacity[s] = agents->scratch_capacity;
+        agents->scratch = swapped;
+        agents->scratch_capacity = swapped_capacity;
+    }
+    return true;
+}
 
-    // Add plants, herbivores and carnivores to the grid randomly
-    for(int i = 0; i < PLANTS; i++) {
-        int x = rand() % GRID_SIZE;
-        int y = rand() % GRID_SIZE;
+// Function to list the agents on cell c and its neighbours that are not listed yet
+static inline bool agent_find_around(EcoSystem *ecoSystem, AgentBuffer *found, uint32_t c) {
+    ptrdiff_t around[5] = {0, ecoSystem->stride, -ecoSystem->stride, 1, -1};
 
-        ecoSystem->grid[x][y] = (Cell){2, 0, 0, false, PLANT};
+    for (int n = 0; n < 5; n++) {
+        ptrdiff_t cell = (ptrdiff_t) c + around[n];
+        uint8_t type = ecoSystem->grid.type[cell];
+        if (type >= EMPTY || (type == PLANT && ecoSystem->plant_events.threads > 0)   // Empty or a ghost cell
+            || __atomic_exchange_n(&ecoSystem->agents.listed[cell], 1, __ATOMIC_RELAXED)) continue;
+        if (!agent_push(&found->cells[type], &found->count[type], &found->capacity[type], (uint32_t) cell)) {
+            return false;
+        }
     }
-    for(int i = 0; i < HERBIVORES; i++) {
-        int x = rand() % GRID_SIZE;
-        int y = rand() % GRID_SIZE;
+    return true;
+}
 
-        while (ecoSystem->grid[x][y].type != EMPTY) {
-            x = rand() % GRID_SIZE;
-            y = rand() % GRID_SIZE;
+// Function to rebuild the lists from the cells listed during the tick and their neighbours
+int agent_lists_rebuild(EcoSystem *ecoSystem) {
+    AgentLists *agents = &ecoSystem->agents;
+    bool ok = true;
+
+    #pragma omp parallel reduction(&& : ok)
+    {
+        trace_begin(&ecoSystem->trace, PHASE_SWEEP);
+        AgentBuffer *found = &agents->found[omp_get_thread_num()];
+        for (int s = PLANT; s <= CARNIVORE; s++) {
+            found->count[s] = 0;
         }
 
-        ecoSystem->grid[x][y] = (Cell){1, 0, 0, false, HERBIVORE};
-    }
-    for(int i = 0; i < CARNIVORES; i++) {
-        int x = rand() % GRID_SIZE;
-        int y = rand() % GRID_SIZE;
+        for (int s = PLANT; s <= CARNIVORE; s++) {
+            #pragma omp for schedule(static)
+            for (size_t k = 0; k < agents->count[s]; k++) {
+                agents->listed[agents->cells[s][k]] = 0;
+            }
+        }
 
-        while (ecoSystem->grid[x][y].type != EMPTY) {
-            x = rand() % GRID_SIZE;
-            y = rand() % GRID_SIZE;
+        // Chunks keep the order of the old lists, so the new ones come out roughly in grid order
+        for (int s = PLANT; s <= CARNIVORE; s++) {
+            #pragma omp for schedule(static) nowait
+            for (size_t k = 0; k < agents->count[s]; k++) {
+                ok = agent_find_around(ecoSystem, found, agents->cells[s][k]) && ok;
+            }
         }
+        trace_end(&ecoSystem->trace, PHASE_SWEEP);
+    }
 
-        ecoSystem->grid[x][y] = (Cell){1, 0, 0, false, CARNIVORE};
+    // Concatenate the per-thread finds and put them in cell order
+    for (int s = PLANT; s <= CARNIVORE; s++) {
+        agents->count[s] = 0;
+        for (int t = 0; t < agents->threads; t++) {
+            AgentBuffer *found = &agents->found[t];
+            for (size_t k = 0; ok && k < found->count[s]; k++) {
+                ok = agent_push(&agents->cells[s], &agents->count[s], &agents->capacity[s], found->cells[s][k]);
+            }
+            found->count[s] = 0;
+        }
+        ok = ok && agent_sort(agents, s, (size_t) ecoSystem->rows * ecoSystem->stride);
     }
+
+    return ok ? 0 : -1;
 }
 
+// ---------------------------------------------------------------------------
+// Plant events (sparse engine, --plant-events)
+//
+// See PlantEvents. A tick first checks last tick's new plants for
+// overpopulation, then runs the reproductions filed for it, and only then the
+// animals of the agent lists. A plant's roll succeeds with probability
+// reproduction / 100 every tick, so the number of ticks to its next success
+// is geometric: drawn once, it replaces one roll per tick. The draws come
+// from streams of their own, keyed by (seed, tick, cell) like every other
+// stream. Being memoryless, a gap can be drawn afresh whenever a plant's
+// surroundings change, and is, for every plant, after init_ecosystem.
+// Checkpoints keep the due ticks and the plants still to check instead, so a
+// resumed run goes on with the same rolls. A plant without an empty neighbour
+// cannot reproduce, so it is left dormant, off the wheel, until a cell next to
+// it is emptied.
+// ---------------------------------------------------------------------------
 
-int main() {
-    // open file 'iter.log' for writing
-    FILE *file = fopen("iter.log", "w");
+#define PLANT_STREAM 0x706c616e74ULL   // Xored into the seed of the plant event streams
+#define PLANT_SORT_BITS 11             // Cell index bits per pass of the slot sort (2048 counters)
 
-    if (file == NULL) {
-        printf("Error opening file!\n");
-        exit(1);
+// Function to open the plant event stream of cell (i, j) at one tick
+static inline Rng plant_rng(const EcoSystem *ecoSystem, uint64_t tick, int i, int j) {
+    return rng_stream(ecoSystem->seed ^ PLANT_STREAM, tick, (uint64_t) i * ecoSystem->cols + j);
+}
+
+// Function to draw the tick of the next successful roll after `tick`, PLANT_DORMANT if there is none
+static uint32_t plant_next_roll(Rng *rng, uint64_t tick, int reproduction_chance) {
+    if (reproduction_chance <= 0) return PLANT_DORMANT;
+
+    uint64_t gap = 1;
+    if (reproduction_chance < 100) {
+        double u = (double) ((rng_next(rng) >> 11) + 1) * 0x1.0p-53;   // (0, 1]
+        double failures = floor(log(u) / log1p(-reproduction_chance / 100.0));
+        gap += failures < UINT32_MAX ? (uint64_t) failures : UINT32_MAX;
     }
+    uint64_t due = tick + gap;   // Wraps around for the RNG_INIT_TICK of a run starting at tick 0
+    return due < PLANT_DORMANT ? (uint32_t) due : PLANT_DORMANT;
+}
 
+// Function to tell whether the plant on (i, j) has an empty neighbour to spawn into
+static inline bool plant_room(const EcoSystem *ecoSystem, int i, int j) {
+    return TYPE(ecoSystem, i + 1, j) == EMPTY || TYPE(ecoSystem, i - 1, j) == EMPTY
+           || TYPE(ecoSystem, i, j + 1) == EMPTY || TYPE(ecoSystem, i, j - 1) == EMPTY;
+}
 
-    // Initialize the ecosystem
-    EcoSystem ecoSystem;
-    init_ecosystem(&ecoSystem);
-    omp_set_dynamic(1);
+// Function to file an entry in the slot of the tick it is due, or taken again
+static bool plant_file(PlantEvents *events, uint64_t entry) {
+    size_t s = (entry >> 32) % PLANT_WHEEL_SLOTS;
+    if (events->count[s] == events->capacity[s]) {
+        size_t grown = events->capacity[s] > 0 ? events->capacity[s] * 2 : 1024;
+        uint64_t *resized = realloc(events->slot[s], grown * sizeof(uint64_t));
+        if (resized == NULL) return false;
+        events->slot[s] = resized;
+        events->capacity[s] = grown;
+    }
+    events->slot[s][events->count[s]++] = entry;
+    return true;
+}
 
-    int i;
-    for(i = 0; i < MAX_TICKS; i++) {
-        reset_acted(&ecoSystem);
-
-        int count_plants = 0;
-        int count_herbivores = 0;
-        int count_carnivores = 0;
-
-        // Update the cells in parallel
-        #pragma omp parallel for schedule(dynamic)
-        for (int t = 0; t < GRID_SIZE; t++) {
-            for (int k = 0; k < GRID_SIZE; k++) {
-                switch (ecoSystem.grid[t][k].type) {
-                    case EMPTY:
-                        break;
-                    case PLANT:
-                        count_plants++;
-                        update_plant(&ecoSystem, 50, t, k);
-                        break;
-                    case HERBIVORE:
-                        count_herbivores++;
-                        update_herbivore(&ecoSystem, t, k);
-                        break;
-                    case CARNIVORE:
-                        count_carnivores++;
-                        update_carnivore(&ecoSystem, t, k);
-                        break;
-                }
-            }
-        }
+static bool plant_refile(PlantBuffer *mine, uint64_t entry) {
+    if (mine->refile_count == mine->refile_capacity) {
+        size_t grown = mine->refile_capacity > 0 ? mine->refile_capacity * 2 : 1024;
+        uint64_t *resized = realloc(mine->refile, grown * sizeof(uint64_t));
+        if (resized == NULL) return false;
+        mine->refile = resized;
+        mine->refile_capacity = grown;
+    }
+    mine->refile[mine->refile_count++] = entry;
+    return true;
+}
 
-        // Write the ecosystem state to the file
-        #pragma omp critical
-        fprintf(file, "Tick %d: Plants: %d, Herbivores: %d, Carnivores: %d\n", i, count_plants, count_herbivores, count_carnivores);
+// Function to schedule the plant on cell c, which appeared or got room at `tick`: its first roll, drawn past
+// the draws of a reproduction at that tick, or dormant if it has nowhere to spawn
+static bool plant_schedule(EcoSystem *ecoSystem, uint32_t c, uint64_t tick, int reproduction_chance) {
+    PlantEvents *events = &ecoSystem->plant_events;
+    int i = (int) (c / (uint32_t) ecoSystem->stride);
+    int j = (int) (c % (uint32_t) ecoSystem->stride);
 
-        if (i % DEBUG_TICK == 0) {
-            printf("Tick %d: Plants: %d, Herbivores: %d, Carnivores: %d\n", i, count_plants, count_herbivores, count_carnivores);
+    events->due[c] = PLANT_DORMANT;
+    if (!plant_room(ecoSystem, i, j)) return true;
 
-            // Print the state of the grid
-            printf("State at Tick %d\n", i);
-            for (int t = 0; t < GRID_SIZE; t++) {
-                for (int k = 0; k < GRID_SIZE; k++) {
-                    switch (ecoSystem.grid[t][k].type) {
-                        case EMPTY:
-                            printf(" %sE%s ", COLOR_EMPTY, COLOR_RESET);
-                            break;
-                        case PLANT:
-                            printf(" %sP%s ", COLOR_PLANT, COLOR_RESET);
-                            break;
-                        case HERBIVORE:
-                            printf(" %sH%s ", COLOR_HERBIVORE, COLOR_RESET);
-                            break;
-                        case CARNIVORE:
-                            printf(" %sC%s ", COLOR_CARNIVORE, COLOR_RESET);
-                            break;
-                    }
-                }
-                printf("\n");
-            }
+    Rng rng = plant_rng(ecoSystem, tick, i, j);
+    rng.counter = 2 * RNG_GAMMA;
+    events->due[c] = plant_next_roll(&rng, tick, reproduction_chance);
+    return events->due[c] == PLANT_DORMANT || plant_file(events, (uint64_t) events->due[c] << 32 | c);
+}
+
+// Function to wake the dormant plants next to cell c, emptied at `tick`
+static bool plant_wake(EcoSystem *ecoSystem, uint32_t c, uint64_t tick, int reproduction_chance) {
+    ptrdiff_t around[4] = {ecoSystem->stride, -ecoSystem->stride, 1, -1};
+    bool ok = true;
+
+    if (ecoSystem->grid.type[c] != EMPTY) return true;   // Taken again later in the tick
+    for (int n = 0; n < 4 && ok; n++) {
+        ptrdiff_t cell = (ptrdiff_t) c + around[n];   // Ghost cells are never plants
+        if (ecoSystem->grid.type[cell] == PLANT && ecoSystem->plant_events.due[cell] == PLANT_DORMANT) {
+            ok = plant_schedule(ecoSystem, (uint32_t) cell, tick, reproduction_chance);
         }
+    }
+    return ok;
+}
 
-        if (count_herbivores == 0 || count_carnivores == 0) {
-            printf("Early stop\n");
-            break;
+// Function to end a tick of the plant events, `tick`: file the entries taken again, schedule the plants that
+// appeared (they get checked at the start of the next tick), wake the plants next to emptied cells and fold
+// the plant totals
+static int plant_events_end(EcoSystem *ecoSystem, uint64_t tick, int reproduction_chance) {
+    PlantEvents *events = &ecoSystem->plant_events;
+    bool ok = true;
+
+    events->check_count = 0;
+    for (int t = 0; t < events->threads; t++) {
+        PlantBuffer *buffer = &events->buffers[t];
+        ok = ok && !buffer->failed;
+        for (size_t k = 0; ok && k < buffer->refile_count; k++) {
+            ok = plant_file(events, buffer->refile[k]);
+        }
+        for (size_t k = 0; ok && k < buffer->count; k++) {
+            uint32_t c = buffer->born[k];
+            if (ecoSystem->grid.type[c] != PLANT) continue;   // Eaten in the tick it appeared
+            ok = plant_schedule(ecoSystem, c, tick, reproduction_chance)
+                 && agent_push(&events->check, &events->check_count, &events->check_capacity, c);
+        }
+    }
+    for (int t = 0; t < events->threads; t++) {
+        PlantBuffer *buffer = &events->buffers[t];
+        for (size_t k = 0; ok && k < buffer->emptied_count; k++) {
+            ok = plant_wake(ecoSystem, buffer->emptied[k], tick, reproduction_chance);
         }
+        events->plants += buffer->plants;
+        events->energy += buffer->energy;
+        buffer->count = 0;
+        buffer->refile_count = 0;
+        buffer->emptied_count = 0;
+        buffer->plants = 0;
+        buffer->energy = 0;
     }
+    return ok ? 0 : -1;
+}
 
-    // Print the final state of the ecosystem
-    if (i % 1000 != 0) {  // Ensure final state is printed if it was not at a multiple of 500
-        printf("Final state\n");
-        for (int t = 0; t < GRID_SIZE; t++) {
-            for (int k = 0; k < GRID_SIZE; k++) {
-                switch (ecoSystem.grid[t][k].type) {
-                    case EMPTY:
-                        printf(" %sE%s ", COLOR_EMPTY, COLOR_RESET);
+// Function to empty the wheel and the per-thread buffers before it is filled from the grid
+static void plant_events_clear(PlantEvents *events) {
+    for (int s = 0; s < PLANT_WHEEL_SLOTS; s++) {
+        events->count[s] = 0;
+    }
+    for (int t = 0; t < events->threads; t++) {
+        PlantBuffer *buffer = &events->buffers[t];
+        buffer->count = 0;
+        buffer->refile_count = 0;
+        buffer->emptied_count = 0;
+        buffer->plants = 0;
+        buffer->energy = 0;
+    }
+    events->plants = 0;
+    events->energy = 0;
+}
+
+// Function to schedule every plant of the grid, after init_ecosystem or a checkpoint without plant events.
+// Their rolls start at the current tick and every one of them gets checked in it.
+int plant_events_scan(EcoSystem *ecoSystem, int reproduction_chance) {
+    PlantEvents *events = &ecoSystem->plant_events;
+    plant_events_clear(events);
+
+    PlantBuffer *first = &events->buffers[0];
+    for (int i = 0; i < ecoSystem->rows; i++) {
+        for (int j = 0; j < ecoSystem->cols && !first->failed; j++) {
+            size_t c = AT(ecoSystem, i, j);
+            if (ecoSystem->grid.type[c] != PLANT) continue;
+            first->plants++;
+            first->energy += ecoSystem->grid.energy[c];
+            first->failed = !agent_push(&first->born, &first->count, &first->capacity, (uint32_t) c);
+        }
+    }
+    return plant_events_end(ecoSystem, ecoSystem->tick - 1, reproduction_chance);
+}
+
+// Function to file every plant of the grid again after checkpoint_load restored their due ticks and the
+// plants to check: the wheel then holds one entry per scheduled plant, which is all its slots ever act on
+int plant_events_restore(EcoSystem *ecoSystem) {
+    PlantEvents *events = &ecoSystem->plant_events;
+    plant_events_clear(events);
+
+    bool ok = true;
+    for (int i = 0; ok && i < ecoSystem->rows; i++) {
+        for (int j = 0; ok && j < ecoSystem->cols; j++) {
+            size_t c = AT(ecoSystem, i, j);
+            if (ecoSystem->grid.type[c] != PLANT) continue;
+            events->plants++;
+            events->energy += ecoSystem->grid.energy[c];
+            if (events->due[c] != PLANT_DORMANT) {
+                ok = plant_file(events, (uint64_t) events->due[c] << 32 | c);
+            }
+        }
+    }
+    return ok ? 0 : -1;
+}
+
+// Function to kill the plant on (i, j) if all four of its neighbours are plants
+static inline void plant_crowded(EcoSystem *ecoSystem, int i, int j) {
+    if (TYPE(ecoSystem, i, j) != PLANT) return;
+
+    int neighbors = (TYPE(ecoSystem, i + 1, j) == PLANT) + (TYPE(ecoSystem, i - 1, j) == PLANT)
+                    + (TYPE(ecoSystem, i, j + 1) == PLANT) + (TYPE(ecoSystem, i, j - 1) == PLANT);
+    if (neighbors <= 3) return;
+
+    lock_cell(ecoSystem, i, j);
+    bool dies = TYPE(ecoSystem, i, j) == PLANT;   // Another new plant may have the same neighbour
+    if (dies) {
+        set_cell(ecoSystem, i, j, (Cell){0, 0, 0, false, EMPTY});  // The plant dies
+    }
+    unlock_cell(ecoSystem, i, j);
+    if (dies) {
+        stats_local(&ecoSystem->stats)->deaths[PLANT][DEATH_OVERPOPULATION]++;
+    }
+}
+
+// Function to run the reproduction filed as `entry` for the current tick
+static inline void plant_fire(EcoSystem *ecoSystem, int reproduction_chance, uint64_t entry, PlantBuffer *mine) {
+    PlantEvents *events = &ecoSystem->plant_events;
+    uint32_t c = (uint32_t) entry, due = (uint32_t) (entry >> 32);
+    int i = (int) (c / (uint32_t) ecoSystem->stride);
+    int j = (int) (c % (uint32_t) ecoSystem->stride);
+
+    if (due != ecoSystem->tick) {
+        // Due in a later turn of the wheel, if the plant is still there
+        if (due > ecoSystem->tick && TYPE(ecoSystem, i, j) == PLANT && events->due[c] == due) {
+            mine->failed = !plant_refile(mine, entry) || mine->failed;
+        }
+        return;
+    }
+
+    Rng rng = plant_rng(ecoSystem, due, i, j);
+    int direction = rng_below(&rng, 4);
+    uint32_t next = plant_next_roll(&rng, due, reproduction_chance);
+
+    lock_cell(ecoSystem, i, j);
+    bool live = TYPE(ecoSystem, i, j) == PLANT && events->due[c] == due;   // Filed twice if it appeared twice
+    if (live) events->due[c] = PLANT_DORMANT;
+    unlock_cell(ecoSystem, i, j);
+    if (!live) return;
+
+    int x = i + DIRECTION_DI[direction], y = j + DIRECTION_DJ[direction];
+    if (TYPE(ecoSystem, x, y) == EMPTY) {
+        lock_cell(ecoSystem, x, y);
+        bool born = TYPE(ecoSystem, x, y) == EMPTY;
+        if (born) {
+            set_cell(ecoSystem, x, y, (Cell){SPECIES_RULES[PLANT].newborn_energy, 0, 0, true, PLANT});  // New plant is born
+        }
+        unlock_cell(ecoSystem, x, y);
+        if (born) {
+            stats_local(&ecoSystem->stats)->births[PLANT]++;
+
+            // The only change that can crowd a plant: check the neighbours now, the new plant next tick
+            plant_crowded(ecoSystem, x + 1, y);
+            plant_crowded(ecoSystem, x - 1, y);
+            plant_crowded(ecoSystem, x, y + 1);
+            plant_crowded(ecoSystem, x, y - 1);
+        }
+    }
+
+    // Next roll, or dormant until a neighbour is emptied
+    if (next != PLANT_DORMANT && TYPE(ecoSystem, i, j) == PLANT && plant_room(ecoSystem, i, j)) {
+        events->due[c] = next;
+        mine->failed = !plant_refile(mine, (uint64_t) next << 32 | c) || mine->failed;
+    }
+}
+
+// Function to sort slot s by cell, with an LSD radix sort of PLANT_SORT_BITS per pass, so that its events
+// walk the planes in order instead of jumping around them
+static bool plant_sort(PlantEvents *events, size_t s, size_t cells) {
+    size_t count = events->count[s];
+    if (events->scratch_capacity < events->capacity[s]) {
+        uint64_t *resized = realloc(events->scratch, events->capacity[s] * sizeof(uint64_t));
+        if (resized == NULL) return false;
+        events->scratch = resized;
+        events->scratch_capacity = events->capacity[s];
+    }
+
+    for (int shift = 0; shift < 32 && (uint64_t) (cells - 1) >> shift > 0; shift += PLANT_SORT_BITS) {
+        size_t start[1 << PLANT_SORT_BITS] = {0};
+        const uint64_t *from = events->slot[s];
+        for (size_t k = 0; k < count; k++) {
+            start[(from[k] >> shift) & ((1 << PLANT_SORT_BITS) - 1)]++;
+        }
+        for (size_t d = 0, sum = 0; d < (1 << PLANT_SORT_BITS); d++) {
+            size_t digits = start[d];
+            start[d] = sum;
+            sum += digits;
+        }
+        for (size_t k = 0; k < count; k++) {
+            events->scratch[start[(from[k] >> shift) & ((1 << PLANT_SORT_BITS) - 1)]++] = from[k];
+        }
+
+        // The sorted copy becomes the slot
+        uint64_t *swapped = events->slot[s];
+        size_t swapped_capacity = events->capacity[s];
+        events->slot[s] = events->scratch;
+        events->capacity[s] = events->scratch_capacity;
+        events->scratch = swapped;
+        events->scratch_capacity = swapped_capacity;
+    }
+    return true;
+}
+
+// Function to run the plant events of the current tick: overpopulation checks of last tick's new plants, then
+// the reproductions
+int plant_events_run(EcoSystem *ecoSystem, int reproduction_chance) {
+    PlantEvents *events = &ecoSystem->plant_events;
+    size_t s = ecoSystem->tick % PLANT_WHEEL_SLOTS;
+    if (!plant_sort(events, s, (size_t) ecoSystem->rows * ecoSystem->stride)) {
+        return -1;
+    }
+
+    // Plants on the grid at the start of the tick
+    TickStats *stats = stats_local(&ecoSystem->stats);
+    stats->population[PLANT] += events->plants;
+    stats->energy[PLANT] += events->energy;
+
+    #pragma omp parallel
+    {
+        trace_begin(&ecoSystem->trace, PHASE_SWEEP);
+        PlantBuffer *mine = &events->buffers[omp_get_thread_num()];
+
+        #pragma omp for schedule(dynamic, 256)
+        for (size_t k = 0; k < events->check_count; k++) {
+            trace_cells(&ecoSystem->trace, 1);
+            plant_crowded(ecoSystem, (int) (events->check[k] / (uint32_t) ecoSystem->stride),
+                          (int) (events->check[k] % (uint32_t) ecoSystem->stride));
+        }
+
+        #pragma omp for schedule(dynamic, 256) nowait
+        for (size_t k = 0; k < events->count[s]; k++) {
+            trace_cells(&ecoSystem->trace, 1);
+            plant_fire(ecoSystem, reproduction_chance, events->slot[s][k], mine);
+        }
+        trace_end(&ecoSystem->trace, PHASE_SWEEP);
+    }
+    events->count[s] = 0;   // Everything it held is in the refile buffers now, or gone
+    return 0;
+}
+
+// Function to advance the sparse engine by one tick
+int step_sparse(EcoSystem *ecoSystem, int reproduction_chance) {
+    AgentLists *agents = &ecoSystem->agents;
+
+    begin_acted(ecoSystem);
+
+    bool plant_events = ecoSystem->plant_events.threads > 0;
+    if (plant_events && plant_events_run(ecoSystem, reproduction_chance) != 0) {
+        return -1;
+    }
+
+    // A listed cell may have been emptied or taken over earlier in the tick, so dispatch on its current type
+    #pragma omp parallel
+    {
+        trace_begin(&ecoSystem->trace, PHASE_SWEEP);
+        for (int s = PLANT; s <= CARNIVORE; s++) {
+            #pragma omp for schedule(dynamic, 256) nowait
+            for (size_t k = 0; k < agents->count[s]; k++) {
+                trace_cells(&ecoSystem->trace, 1);
+                int t = (int) (agents->cells[s][k] / (uint32_t) ecoSystem->stride);
+                int c = (int) (agents->cells[s][k] % (uint32_t) ecoSystem->stride);
+                switch (TYPE(ecoSystem, t, c)) {
+                    case EMPTY:
                         break;
                     case PLANT:
-                        printf(" %sP%s ", COLOR_PLANT, COLOR_RESET);
+                        if (!plant_events) update_plant(ecoSystem, reproduction_chance, t, c);
                         break;
                     case HERBIVORE:
-                        printf(" %sH%s ", COLOR_HERBIVORE, COLOR_RESET);
+                        update_herbivore(ecoSystem, t, c);
                         break;
                     case CARNIVORE:
-                        printf(" %sC%s ", COLOR_CARNIVORE, COLOR_RESET);
+                        update_carnivore(ecoSystem, t, c);
                         break;
                 }
             }
-            printf("\n");
         }
-        printf("Tick %d\n", i);
+        trace_end(&ecoSystem->trace, PHASE_SWEEP);
     }
 
-    // Close the file
-    fclose(file);
+    if (plant_events && plant_events_end(ecoSystem, ecoSystem->tick, reproduction_chance) != 0) {
+        return -1;
+    }
+    return agent_lists_rebuild(ecoSystem);
+}
 
-    return 0;
+// ---------------------------------------------------------------------------
+// Plant row kernels
+//
+// For one row of the type plane these compute, for every cell at once, whether
+// a plant dies of overpopulation (all four neighbours are plants) and whether
+// it can reproduce at all (it survives and has at least one empty neighbour).
+// `up` and `down` are the neighbouring rows, and row[-1] and row[cols] the
+// ghost cells of the row (see AT), read like any other neighbour. The widest
+// kernel the CPU supports is chosen at startup, see select_plant_kernel().
+// ---------------------------------------------------------------------------
+
+#define PLANT_DIES 1        // Overpopulated plant
+#define PLANT_CAN_SPAWN 2   // Surviving plant with an empty neighbour
+
+// Function to compute the plant masks of cells [from, to) of a row one cell at a time
+static inline void plant_row_cells(const uint8_t *up, const uint8_t *row, const uint8_t *down,
+                                   uint8_t *out, int from, int to) {
+    for (int j = from; j < to; j++) {
+        uint8_t left = row[j - 1], right = row[j + 1];
+        int plants = (up[j] == PLANT) + (down[j] == PLANT) + (left == PLANT) + (right == PLANT);
+        bool empty = up[j] == EMPTY || down[j] == EMPTY || left == EMPTY || right == EMPTY;
+
+        if (row[j] != PLANT) {
+            out[j] = 0;
+        } else if (plants > 3) {
+            out[j] = PLANT_DIES;
+        } else {
+            out[j] = empty ? PLANT_CAN_SPAWN : 0;
+        }
+    }
+}
+
+void plant_row_scalar(const uint8_t *up, const uint8_t *row, const uint8_t *down, uint8_t *out, int cols) {
+    plant_row_cells(up, row, down, out, 0, cols);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+// SSE2, 16 cells per step
+__attribute__((target("sse2")))
+void plant_row_sse2(const uint8_t *up, const uint8_t *row, const uint8_t *down, uint8_t *out, int cols) {
+    const __m128i plant = _mm_set1_epi8(PLANT);
+    const __m128i empty = _mm_set1_epi8(EMPTY);
+    const __m128i four = _mm_set1_epi8(4);
+    const __m128i dies_bit = _mm_set1_epi8(PLANT_DIES);
+    const __m128i spawn_bit = _mm_set1_epi8(PLANT_CAN_SPAWN);
+
+    // Vectorised up to the last full step, the rest one cell at a time
+    int j = 0;
+    for (; j + 16 <= cols; j += 16) {
+        __m128i self = _mm_loadu_si128((const __m128i *) (row + j));
+        __m128i left = _mm_loadu_si128((const __m128i *) (row + j - 1));
+        __m128i right = _mm_loadu_si128((const __m128i *) (row + j + 1));
+        __m128i above = _mm_loadu_si128((const __m128i *) (up + j));
+        __m128i below = _mm_loadu_si128((const __m128i *) (down + j));
+
+        // Compares give -1 per matching byte, so subtracting them counts the plant neighbours
+        __m128i plants = _mm_sub_epi8(_mm_setzero_si128(), _mm_cmpeq_epi8(left, plant));
+        plants = _mm_sub_epi8(plants, _mm_cmpeq_epi8(right, plant));
+        plants = _mm_sub_epi8(plants, _mm_cmpeq_epi8(above, plant));
+        plants = _mm_sub_epi8(plants, _mm_cmpeq_epi8(below, plant));
+        __m128i empties = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(left, empty), _mm_cmpeq_epi8(right, empty)),
+                                       _mm_or_si128(_mm_cmpeq_epi8(above, empty), _mm_cmpeq_epi8(below, empty)));
+
+        __m128i is_plant = _mm_cmpeq_epi8(self, plant);
+        __m128i dies = _mm_and_si128(is_plant, _mm_cmpeq_epi8(plants, four));
+        __m128i spawn = _mm_andnot_si128(dies, _mm_and_si128(is_plant, empties));
+
+        __m128i mask = _mm_or_si128(_mm_and_si128(dies, dies_bit), _mm_and_si128(spawn, spawn_bit));
+        _mm_storeu_si128((__m128i *) (out + j), mask);
+    }
+
+    plant_row_cells(up, row, down, out, j, cols);
+}
+
+// AVX2, 32 cells per step
+__attribute__((target("avx2")))
+void plant_row_avx2(const uint8_t *up, const uint8_t *row, const uint8_t *down, uint8_t *out, int cols) {
+    const __m256i plant = _mm256_set1_epi8(PLANT);
+    const __m256i empty = _mm256_set1_epi8(EMPTY);
+    const __m256i four = _mm256_set1_epi8(4);
+    const __m256i dies_bit = _mm256_set1_epi8(PLANT_DIES);
+    const __m256i spawn_bit = _mm256_set1_epi8(PLANT_CAN_SPAWN);
+
+    int j = 0;
+    for (; j + 32 <= cols; j += 32) {
+        __m256i self = _mm256_loadu_si256((const __m256i *) (row + j));
+        __m256i left = _mm256_loadu_si256((const __m256i *) (row + j - 1));
+        __m256i right = _mm256_loadu_si256((const __m256i *) (row + j + 1));
+        __m256i above = _mm256_loadu_si256((const __m256i *) (up + j));
+        __m256i below = _mm256_loadu_si256((const __m256i *) (down + j));
+
+        __m256i plants = _mm256_sub_epi8(_mm256_setzero_si256(), _mm256_cmpeq_epi8(left, plant));
+        plants = _mm256_sub_epi8(plants, _mm256_cmpeq_epi8(right, plant));
+        plants = _mm256_sub_epi8(plants, _mm256_cmpeq_epi8(above, plant));
+        plants = _mm256_sub_epi8(plants, _mm256_cmpeq_epi8(below, plant));
+        __m256i empties = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(left, empty), _mm256_cmpeq_epi8(right, empty)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(above, empty), _mm256_cmpeq_epi8(below, empty)));
+
+        __m256i is_plant = _mm256_cmpeq_epi8(self, plant);
+        __m256i dies = _mm256_and_si256(is_plant, _mm256_cmpeq_epi8(plants, four));
+        __m256i spawn = _mm256_andnot_si256(dies, _mm256_and_si256(is_plant, empties));
+
+        __m256i mask = _mm256_or_si256(_mm256_and_si256(dies, dies_bit), _mm256_and_si256(spawn, spawn_bit));
+        _mm256_storeu_si256((__m256i *) (out + j), mask);
+    }
+
+    plant_row_cells(up, row, down, out, j, cols);
+}
+#endif
+
+// Function to pick the plant row kernel, falling back to narrower ones the CPU lacks
+PlantRowKernel select_plant_kernel(SimdLevel requested, const char **name) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if ((requested == SIMD_AUTO || requested == SIMD_AVX2) && __builtin_cpu_supports("avx2")) {
+        *name = "avx2";
+        return plant_row_avx2;
+    }
+    if (requested != SIMD_SCALAR && __builtin_cpu_supports("sse2")) {
+        *name = "sse2";
+        return plant_row_sse2;
+    }
+#else
+    (void) requested;
+#endif
+    *name = "scalar";
+    return plant_row_scalar;
+}
+
+// ---------------------------------------------------------------------------
+// Species bitboards
+//
+// Optional second view of the type plane with one bit per cell and one bit
+// plane per species. Bit b of word w of a row is column 64 * w + b; the bits
+// past the last column are always zero. Populations then come from popcount
+// and the plant neighbourhood tests from shifts, 64 cells per operation.
+// ---------------------------------------------------------------------------
+
+#define BYTE_HIGH_BITS 0x7F7F7F7F7F7F7F7FULL
+#define GATHER_BYTE_BITS 0x0102040810204080ULL
+
+// Function to turn eight type bytes into an 8-bit mask of the ones equal to `type`
+static inline uint64_t match_x8(const uint8_t *types, uint8_t type) {
+    uint64_t word;
+    memcpy(&word, types, sizeof(word));
+
+    // Bytes equal to `type` become zero, then exactly those get 0x80
+    uint64_t x = word ^ (0x0101010101010101ULL * type);
+    uint64_t zero = ~(((x & BYTE_HIGH_BITS) + BYTE_HIGH_BITS) | x | BYTE_HIGH_BITS);
+
+    // Move the eight 0x80 flags into the eight low bits (bit k = byte k)
+    return ((zero >> 7) * GATHER_BYTE_BITS) >> 56;
+}
+
+// Function to rebuild the bitboards of row i from the type plane
+void bitboard_build_row(EcoSystem *ecoSystem, int i) {
+    Bitboard *bits = &ecoSystem->bits;
+    const uint8_t *types = &TYPE(ecoSystem, i, 0);
+    int cols = ecoSystem->cols;
+
+    for (int w = 0; w < bits->words; w++) {
+        uint64_t species[3] = {0, 0, 0};
+        int first = w * 64;
+        int last = first + 64 < cols ? first + 64 : cols;
+        int j = first;
+
+        for (; j + 8 <= last; j += 8) {
+            for (int s = PLANT; s <= CARNIVORE; s++) {
+                species[s] |= match_x8(types + j, (uint8_t) s) << (j - first);
+            }
+        }
+        for (; j < last; j++) {
+            if (types[j] != EMPTY) species[types[j]] |= 1ULL << (j - first);
+        }
+
+        for (int s = PLANT; s <= CARNIVORE; s++) {
+            bits->species[s][(size_t) i * bits->words + w] = species[s];
+        }
+    }
+}
+
+// Function to rebuild all the bitboards
+void bitboard_build(EcoSystem *ecoSystem) {
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < ecoSystem->rows; i++) {
+        bitboard_build_row(ecoSystem, i);
+    }
+}
+
+// Function to count every species with popcount
+void bitboard_count(const EcoSystem *ecoSystem, int counts[3]) {
+    const Bitboard *bits = &ecoSystem->bits;
+    size_t words = (size_t) ecoSystem->rows * bits->words;
+    long long plants = 0, herbivores = 0, carnivores = 0;
+
+    #pragma omp parallel for schedule(static) reduction(+:plants, herbivores, carnivores)
+    for (size_t w = 0; w < words; w++) {
+        plants += __builtin_popcountll(bits->species[PLANT][w]);
+        herbivores += __builtin_popcountll(bits->species[HERBIVORE][w]);
+        carnivores += __builtin_popcountll(bits->species[CARNIVORE][w]);
+    }
+
+    counts[PLANT] = (int) plants;
+    counts[HERBIVORE] = (int) herbivores;
+    counts[CARNIVORE] = (int) carnivores;
+}
+
+// Function to get word w of a bit row, zero outside the grid
+static inline uint64_t bit_word(const Bitboard *bits, const uint64_t *plane, int rows, int i, int w) {
+    if (i < 0 || i >= rows || w < 0 || w >= bits->words) return 0;
+    return plane[(size_t) i * bits->words + w];
+}
+
+// Function to compute the plant row kernel masks of row i from the bitboards
+void bitboard_plant_row(const EcoSystem *ecoSystem, int i, uint8_t *out) {
+    const Bitboard *bits = &ecoSystem->bits;
+    int rows = ecoSystem->rows, cols = ecoSystem->cols;
+
+    for (int w = 0; w < bits->words; w++) {
+        int first = w * 64;
+        int width = cols - first < 64 ? cols - first : 64;
+        uint64_t valid = width == 64 ? ~0ULL : (1ULL << width) - 1;
+
+        // Neighbour masks of one species: bit b says "the cell above / below / left / right of b is one"
+        uint64_t above[3], below[3], left[3], right[3];
+        for (int s = PLANT; s <= CARNIVORE; s++) {
+            const uint64_t *plane = bits->species[s];
+            uint64_t self = bit_word(bits, plane, rows, i, w);
+            above[s] = bit_word(bits, plane, rows, i - 1, w);
+            below[s] = bit_word(bits, plane, rows, i + 1, w);
+            left[s] = (self << 1) | (bit_word(bits, plane, rows, i, w - 1) >> 63);
+            right[s] = (self >> 1) | (bit_word(bits, plane, rows, i, w + 1) << 63);
+        }
+
+        // Empty neighbours: on the grid and of no species
+        uint64_t on_grid_above = i > 0 ? valid : 0;
+        uint64_t on_grid_below = i + 1 < rows ? valid : 0;
+        uint64_t on_grid_left = valid & ~1ULL;
+        uint64_t on_grid_right = (first + width < cols ? ~0ULL : valid >> 1) & valid;
+        if (w > 0) on_grid_left |= 1;
+
+        uint64_t empty_neighbour =
+            (on_grid_above & ~(above[PLANT] | above[HERBIVORE] | above[CARNIVORE]))
+            | (on_grid_below & ~(below[PLANT] | below[HERBIVORE] | below[CARNIVORE]))
+            | (on_grid_left & ~(left[PLANT] | left[HERBIVORE] | left[CARNIVORE]))
+            | (on_grid_right & ~(right[PLANT] | right[HERBIVORE] | right[CARNIVORE]));
+
+        uint64_t plant = bit_word(bits, bits->species[PLANT], rows, i, w);
+        uint64_t dies = plant & above[PLANT] & below[PLANT] & left[PLANT] & right[PLANT];
+        uint64_t spawn = plant & ~dies & empty_neighbour;
+
+        if ((dies | spawn) == 0) {
+            memset(out + first, 0, (size_t) width);
+            continue;
+        }
+        for (int b = 0; b < width; b++) {
+            out[first + b] = (uint8_t) ((((dies >> b) & 1) * PLANT_DIES) | (((spawn >> b) & 1) * PLANT_CAN_SPAWN));
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Double-buffered engine
+//
+// Tick N is read from the front buffer (grid) and tick N + 1 is written into
+// the back buffer, so no cell is ever written by two threads and no locks are
+// needed. A tick runs as three gather sweeps:
+//
+//   1. plan:    every agent picks its action (stay, die, move, eat or spawn)
+//               and a direction from the front buffer and its random stream.
+//   2. resolve: every target cell chooses at most one of the neighbours that
+//               claim it. Predation is resolved first, and a herbivore that
+//               is eaten loses every claim of its own. Among the remaining
+//               claims, carnivores beat herbivores beat plants, moves beat
+//               spawns, and ties go to the first claimant clockwise from a
+//               per-(tick, cell) random start direction.
+//   3. commit:  every cell builds its next state from the front buffer, its
+//               own plan and the claim it won (if any). An agent that lost
+//               its claim stays where it is and counts one more hungry tick.
+// ---------------------------------------------------------------------------
+
+// Planned actions, stored in bits 2-4 of an intent byte (bits 0-1 hold the direction)
+enum {
+    ACTION_STAY,
+    ACTION_DIE,
+    ACTION_MOVE,     // Move into an empty cell
+    ACTION_EAT,      // Move into the prey's cell and take its energy
+    ACTION_SPAWN     // Place a newborn in an empty cell
+};
+
+#define INTENT(action, direction) ((uint8_t) (((action) << 2) | (direction)))
+#define INTENT_ACTION(intent) (((intent) >> 2) & 7)
+#define INTENT_DIRECTION(intent) ((intent) & 3)
+#define INTENT_HUNGRY 0x20   // The agent did not eat this tick: starve + 1
+#define NO_CLAIM 0xFF
+
+// Function to plan the action of the plant at (i, j) from its plant row kernel mask
+uint8_t plan_plant(const EcoSystem *ecoSystem, int reproduction_chance, int i, int j, uint8_t mask) {
+    // Death by overpopulation
+    if (mask & PLANT_DIES) {
+        return INTENT(ACTION_DIE, 0);
+    }
+    if (!(mask & PLANT_CAN_SPAWN)) {
+        return INTENT(ACTION_STAY, 0);  // No empty neighbour to reproduce into
+    }
+
+    // Reproduction
+    Rng rng = cell_rng(ecoSystem, i, j);
+    int direction = rng_below(&rng, 4);
+    int x = i + DIRECTION_DI[direction], y = j + DIRECTION_DJ[direction];
+    if (TYPE(ecoSystem, x, y) == EMPTY && rng_below(&rng, 100) < reproduction_chance) {
+        return INTENT(ACTION_SPAWN, direction);
+    }
+
+    return INTENT(ACTION_STAY, 0);
+}
+
+// Function to plan the action of the animal at (i, j); specialised per species like update_animal
+static inline __attribute__((always_inline)) uint8_t plan_animal(const EcoSystem *ecoSystem, int i, int j,
+                                                                 CellType species) {
+    const SpeciesRules *rules = &SPECIES_RULES[species];
+    Cell self = get_cell(ecoSystem, i, j);
+    Rng rng = cell_rng(ecoSystem, i, j);
+
+    // Death by starvation and by age
+    if (self.starve > rules->starvation) {
+        return INTENT(ACTION_DIE, 0);
+    }
+    if (dies_of_age(ecoSystem, &rng, species, self.age + 1)) {
+        return INTENT(ACTION_DIE, 0);
+    }
+
+    // Movement; the ghost cells of a reflecting boundary match nothing below, so the agent stays
+    int direction = rng_below(&rng, 4);
+    int x = i + DIRECTION_DI[direction], y = j + DIRECTION_DJ[direction];
+
+    CellType target = TYPE(ecoSystem, x, y);
+    if (target == rules->prey) {
+        return INTENT(ACTION_EAT, direction);
+    }
+    if (target == EMPTY) {
+        return INTENT(self.energy > rules->spawn_energy ? ACTION_SPAWN : ACTION_MOVE, direction) | INTENT_HUNGRY;
+    }
+    if (rules->predator != EMPTY && target == rules->predator) {
+        if (rng_below(&rng, 100) < rules->freeze_chance) {
+            return INTENT(ACTION_STAY, 0) | INTENT_HUNGRY;
+        }
+        // Move away from the predator
+        x = i + DIRECTION_DI[direction ^ 1];
+        y = j + DIRECTION_DJ[direction ^ 1];
+        if (TYPE(ecoSystem, x, y) == EMPTY) {
+            return INTENT(ACTION_MOVE, direction ^ 1);
+        }
+    }
+    return INTENT(ACTION_STAY, 0);
+}
+
+// Function to plan the action of the herbivore at (i, j)
+uint8_t plan_herbivore(const EcoSystem *ecoSystem, int i, int j) {
+    return plan_animal(ecoSystem, i, j, HERBIVORE);
+}
+
+// Function to plan the action of the carnivore at (i, j)
+uint8_t plan_carnivore(const EcoSystem *ecoSystem, int i, int j) {
+    return plan_animal(ecoSystem, i, j, CARNIVORE);
+}
+
+// Function to rank a claim on a cell: higher wins, 0 means the claim is not valid
+static inline int claim_rank(CellType claimant, int action, CellType target) {
+    switch (target) {
+        case HERBIVORE:
+            return claimant == CARNIVORE && action == ACTION_EAT ? 1 : 0;
+        case PLANT:
+            return claimant == HERBIVORE && action == ACTION_EAT ? 1 : 0;
+        case EMPTY:
+            if (action != ACTION_MOVE && action != ACTION_SPAWN) return 0;
+            return 2 * claimant + (action == ACTION_MOVE ? 2 : 1);
+        default:
+            return 0;
+    }
+}
+
+// Function to choose which neighbour (if any) takes the cell (i, j) next tick
+uint8_t resolve_claim(const EcoSystem *ecoSystem, int i, int j) {
+    CellType target = TYPE(ecoSystem, i, j);
+    if (target == CARNIVORE) {
+        return NO_CLAIM;
+    }
+
+    int ranks[4];
+    int best_rank = 0;
+    int ties = 0;
+
+    // The ghost cells of a reflecting boundary plan to stay, so they never claim anything
+    for (int from = 0; from < 4; from++) {   // Direction from (i, j) to the claimant
+        ranks[from] = 0;
+        ptrdiff_t n = AT(ecoSystem, i + DIRECTION_DI[from], j + DIRECTION_DJ[from]);
+
+        uint8_t intent = ecoSystem->intent[n];
+        if (INTENT_DIRECTION(intent) != (from ^ 1)) continue;   // Not heading here
+
+        CellType claimant = ecoSystem->grid.type[n];
+
+        // A herbivore that is being eaten this tick cannot claim anything else
+        if (claimant == HERBIVORE && target != HERBIVORE && ecoSystem->claim[n] != NO_CLAIM) continue;
+
+        ranks[from] = claim_rank(claimant, INTENT_ACTION(intent), target);
+        if (ranks[from] > best_rank) {
+            best_rank = ranks[from];
+            ties = 1;
+        } else if (ranks[from] == best_rank && best_rank > 0) {
+            ties++;
+        }
+    }
+
+    if (best_rank == 0) {
+        return NO_CLAIM;
+    }
+
+    // Break ties clockwise from a random start direction
+    int start = 0;
+    if (ties > 1) {
+        Rng rng = rng_stream(ecoSystem->seed, ecoSystem->tick,
+                             (uint64_t) ecoSystem->rows * ecoSystem->cols + (uint64_t) i * ecoSystem->cols + j);
+        start = rng_below(&rng, 4);
+    }
+
+    uint8_t best = NO_CLAIM;
+    for (int k = 0; k < 4 && best == NO_CLAIM; k++) {
+        int from = (start + k) & 3;
+        if (ranks[from] == best_rank) best = (uint8_t) (from ^ 1);   // Stored as the claimant's direction
+    }
+
+    return best;
+}
+
+// Function to build the state an agent keeps when it does not leave its cell
+static inline Cell staged_cell(Cell self, uint8_t intent) {
+    if (self.type != PLANT) {
+        self.age += 1;
+        if (intent & INTENT_HUNGRY) self.starve += 1;
+    }
+    self.acted = false;
+    return self;
+}
+
+// Function to compute the next state of cell (i, j), recording its births, deaths and moves
+Cell commit_cell(const EcoSystem *ecoSystem, int i, int j, TickStats *stats) {
+    ptrdiff_t c = AT(ecoSystem, i, j);
+    Cell self = load_cell(&ecoSystem->grid, c);
+    uint8_t claim = ecoSystem->claim[c];
+
+    // A neighbour won this cell
+    if (claim != NO_CLAIM) {
+        ptrdiff_t n = AT(ecoSystem, i + DIRECTION_DI[claim ^ 1], j + DIRECTION_DJ[claim ^ 1]);
+        Cell winner = load_cell(&ecoSystem->grid, n);
+        uint8_t intent = ecoSystem->intent[n];
+
+        switch (INTENT_ACTION(intent)) {
+            case ACTION_EAT:
+                stats->deaths[self.type][DEATH_PREDATION]++;
+                stats->moves[winner.type]++;
+                return (Cell){winner.energy + self.energy, winner.age + 1, 0, false, winner.type};
+            case ACTION_MOVE:
+                stats->moves[winner.type]++;
+                return staged_cell(winner, intent);
+            default:  // ACTION_SPAWN
+                stats->births[winner.type]++;
+                return (Cell){SPECIES_RULES[winner.type].newborn_energy, 0, 0, false, winner.type};
+        }
+    }
+
+    if (self.type == EMPTY) {
+        return self;
+    }
+
+    uint8_t intent = ecoSystem->intent[c];
+    int action = INTENT_ACTION(intent);
+    if (action == ACTION_DIE) {
+        if (self.type == PLANT) {
+            stats->deaths[PLANT][DEATH_OVERPOPULATION]++;
+        } else {
+            bool starved = self.starve > SPECIES_RULES[self.type].starvation;
+            stats->deaths[self.type][starved ? DEATH_STARVATION : DEATH_AGE]++;
+        }
+        return (Cell){0, 0, 0, false, EMPTY};
+    }
+
+    Cell next = staged_cell(self, intent);
+    if (action == ACTION_STAY) {
+        return next;
+    }
+
+    int direction = INTENT_DIRECTION(intent);
+    bool won = ecoSystem->claim[AT(ecoSystem, i + DIRECTION_DI[direction], j + DIRECTION_DJ[direction])] == direction;
+
+    if (!won) {
+        // Blocked by a stronger claim: stay and go hungry
+        if (self.type != PLANT && !(intent & INTENT_HUNGRY)) next.starve += 1;
+        return next;
+    }
+    if (action != ACTION_SPAWN) {
+        return (Cell){0, 0, 0, false, EMPTY};  // The agent left
+    }
+
+    // The parent pays for the newborn
+    next.energy -= SPECIES_RULES[self.type].spawn_cost;
+    return next;
+}
+
+// Function to copy the edge cells of a per-cell array of `size`-byte elements into the ghost cells on the
+// opposite side, so that neighbour reads wrap around (--boundary torus). The corners are never read.
+static void wrap_plane(const EcoSystem *ecoSystem, void *plane, size_t size) {
+    unsigned char *cells = plane;
+    int rows = ecoSystem->rows, cols = ecoSystem->cols;
+
+    for (int i = 0; i < rows; i++) {
+        memcpy(cells + AT(ecoSystem, i, -1) * (ptrdiff_t) size, cells + AT(ecoSystem, i, cols - 1) * (ptrdiff_t) size, size);
+        memcpy(cells + AT(ecoSystem, i, cols) * (ptrdiff_t) size, cells + AT(ecoSystem, i, 0) * (ptrdiff_t) size, size);
+    }
+    memcpy(cells + AT(ecoSystem, -1, 0) * (ptrdiff_t) size, cells + AT(ecoSystem, rows - 1, 0) * (ptrdiff_t) size,
+           (size_t) cols * size);
+    memcpy(cells + AT(ecoSystem, rows, 0) * (ptrdiff_t) size, cells + AT(ecoSystem, 0, 0) * (ptrdiff_t) size,
+           (size_t) cols * size);
+}
+
+// Bytes between the plant mask rows of two threads, whole cache lines so that no two threads share one
+#define PLANT_MASK_STRIDE(cols) (((size_t) (cols) + STATS_CACHE_LINE - 1) / STATS_CACHE_LINE * STATS_CACHE_LINE)
+
+// Function to advance the double-buffered engine by one tick. On a torus every array a sweep reads around a
+// cell gets its ghost cells refreshed once the sweep before it is done, so the edges see the opposite side
+// exactly as it is in that phase.
+void step_buffered(EcoSystem *ecoSystem, int reproduction_chance) {
+    int rows = ecoSystem->rows, cols = ecoSystem->cols;
+    bool torus = ecoSystem->boundary == BOUNDARY_TORUS;
+
+    if (torus) {
+        wrap_plane(ecoSystem, ecoSystem->grid.type, sizeof(uint8_t));
+        wrap_plane(ecoSystem, ecoSystem->grid.energy, sizeof(uint16_t));
+        wrap_plane(ecoSystem, ecoSystem->grid.age, sizeof(uint8_t));
+        wrap_plane(ecoSystem, ecoSystem->grid.starve, sizeof(uint8_t));
+    }
+
+    #pragma omp parallel
+    {
+        trace_begin(&ecoSystem->trace, PHASE_SWEEP);
+        TickStats *stats = stats_local(&ecoSystem->stats);
+
+        uint8_t *plant_mask = ecoSystem->plant_masks + (size_t) omp_get_thread_num() * PLANT_MASK_STRIDE(cols);
+
+        // 1. Plan (the bitboards have no ghost cells, so they only stand in for the walls)
+        #pragma omp for schedule(static)
+        for (int i = 0; i < rows; i++) {
+            if (ecoSystem->bits.words > 0 && !torus) {
+                bitboard_plant_row(ecoSystem, i, plant_mask);
+            } else {
+                ecoSystem->plant_kernel(&TYPE(ecoSystem, i - 1, 0), &TYPE(ecoSystem, i, 0), &TYPE(ecoSystem, i + 1, 0),
+                                        plant_mask, cols);
+            }
+
+            for (int j = 0; j < cols; j++) {
+                uint8_t intent = INTENT(ACTION_STAY, 0);
+                CellType type = TYPE(ecoSystem, i, j);
+                if (type != EMPTY) {
+                    stats->population[type]++;
+                    stats->energy[type] += ENERGY(ecoSystem, i, j);
+                }
+                switch (type) {
+                    case EMPTY:
+                        break;
+                    case PLANT:
+                        intent = plan_plant(ecoSystem, reproduction_chance, i, j, plant_mask[j]);
+                        break;
+                    case HERBIVORE:
+                        intent = plan_herbivore(ecoSystem, i, j);
+                        break;
+                    case CARNIVORE:
+                        intent = plan_carnivore(ecoSystem, i, j);
+                        break;
+                }
+                ecoSystem->intent[AT(ecoSystem, i, j)] = intent;
+            }
+            trace_cells(&ecoSystem->trace, cols);
+        }
+
+        if (torus) {
+            #pragma omp single
+            wrap_plane(ecoSystem, ecoSystem->intent, sizeof(uint8_t));
+        }
+
+        // 2a. Resolve predation, so eaten herbivores are known before their own claims
+        #pragma omp for schedule(static)
+        for (int i = 0; i < rows; i++) {
+            for (int j = 0; j < cols; j++) {
+                ecoSystem->claim[AT(ecoSystem, i, j)] =
+                    TYPE(ecoSystem, i, j) == HERBIVORE ? resolve_claim(ecoSystem, i, j) : NO_CLAIM;
+            }
+        }
+        if (torus) {
+            #pragma omp single
+            wrap_plane(ecoSystem, ecoSystem->claim, sizeof(uint8_t));
+        }
+
+        // 2b. Resolve moves, meals of plants and spawns
+        #pragma omp for schedule(static)
+        for (int i = 0; i < rows; i++) {
+            for (int j = 0; j < cols; j++) {
+                CellType type = TYPE(ecoSystem, i, j);
+                if (type == EMPTY || type == PLANT) {
+                    ecoSystem->claim[AT(ecoSystem, i, j)] = resolve_claim(ecoSystem, i, j);
+                }
+            }
+        }
+        if (torus) {
+            #pragma omp single
+            wrap_plane(ecoSystem, ecoSystem->claim, sizeof(uint8_t));
+        }
+
+        // 3. Commit into the back buffer
+        #pragma omp for schedule(static)
+        for (int i = 0; i < rows; i++) {
+            for (int j = 0; j < cols; j++) {
+                store_cell(&ecoSystem->back, AT(ecoSystem, i, j), commit_cell(ecoSystem, i, j, stats));
+            }
+        }
+        trace_end(&ecoSystem->trace, PHASE_SWEEP);
+    }
+
+    // The back buffer becomes the front buffer of the next tick
+    Planes front = ecoSystem->grid;
+    ecoSystem->grid = ecoSystem->back;
+    ecoSystem->back = front;
+}
+
+// Function to advance any engine by one tick; fails only when the sparse engine cannot grow its lists
+int step_engine(EcoSystem *ecoSystem, Engine engine, int reproduction_chance) {
+    switch (engine) {
+        case ENGINE_BUFFERED:
+            step_buffered(ecoSystem, reproduction_chance);
+            return 0;
+        case ENGINE_TILES:
+            step_tiles(ecoSystem, reproduction_chance);
+            return 0;
+        case ENGINE_SPARSE:
+            return step_sparse(ecoSystem, reproduction_chance);
+        default:
+            step_locked(ecoSystem, reproduction_chance);
+            return 0;
+    }
+}
+
+// Function to round a grid block up to whole pages of its backing
+static size_t grid_block_size(const EcoSystem *ecoSystem, size_t bytes) {
+    size_t page = ecoSystem->huge_pages == HUGE_PAGES_OFF ? (size_t) sysconf(_SC_PAGESIZE) : HUGE_PAGE_SIZE;
+    return (bytes + page - 1) / page * page;
+}
+
+// Function to map a zeroed block for a per-cell array. Nothing is written here: every page is first
+// touched by the thread that owns its tiles (see first_touch), which places it on that thread's NUMA node.
+void *grid_alloc(EcoSystem *ecoSystem, size_t count, size_t size) {
+    size_t bytes = grid_block_size(ecoSystem, count * size);
+    int protection = PROT_READ | PROT_WRITE;
+
+    if (ecoSystem->huge_pages == HUGE_PAGES_EXPLICIT) {
+        void *block = mmap(NULL, bytes, protection, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (block != MAP_FAILED) return block;
+        ecoSystem->huge_page_fallbacks++;
+    }
+    if (ecoSystem->huge_pages == HUGE_PAGES_OFF) {
+        void *block = mmap(NULL, bytes, protection, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return block != MAP_FAILED ? block : NULL;
+    }
+
+    // Transparent huge pages only back 2 MiB-aligned ranges: map one extra huge page and trim
+    unsigned char *mapping = mmap(NULL, bytes + HUGE_PAGE_SIZE, protection, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) return NULL;
+    unsigned char *block = (unsigned char *) (((uintptr_t) mapping + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1));
+    if (block > mapping) munmap(mapping, (size_t) (block - mapping));
+    munmap(block + bytes, (size_t) (mapping + HUGE_PAGE_SIZE - block));
+    madvise(block, bytes, MADV_HUGEPAGE);
+    return block;
+}
+
+void grid_free(const EcoSystem *ecoSystem, void *block, size_t count, size_t size) {
+    if (block != NULL) munmap(block, grid_block_size(ecoSystem, count * size));
+}
+
+// Function to allocate a per-cell array with its ghost ring (see grid_alloc), returning the address of
+// cell (0, 0): (rows + 2) * stride elements, the first row and cell of which are ghosts
+void *plane_alloc(EcoSystem *ecoSystem, size_t size) {
+    unsigned char *block = grid_alloc(ecoSystem, (size_t) (ecoSystem->rows + 2) * ecoSystem->stride, size);
+    return block != NULL ? block + (size_t) (ecoSystem->stride + 1) * size : NULL;
+}
+
+void plane_free(const EcoSystem *ecoSystem, void *plane, size_t size) {
+    if (plane != NULL) {
+        grid_free(ecoSystem, (unsigned char *) plane - (size_t) (ecoSystem->stride + 1) * size,
+                  (size_t) (ecoSystem->rows + 2) * ecoSystem->stride, size);
+    }
+}
+
+// Function to allocate one set of planes (see plane_alloc; first_touch empties them)
+int alloc_planes(EcoSystem *ecoSystem, Planes *planes, bool with_acted) {
+    planes->type = plane_alloc(ecoSystem, sizeof(uint8_t));
+    planes->energy = plane_alloc(ecoSystem, sizeof(uint16_t));
+    planes->age = plane_alloc(ecoSystem, sizeof(uint8_t));
+    planes->starve = plane_alloc(ecoSystem, sizeof(uint8_t));
+    planes->acted = with_acted ? plane_alloc(ecoSystem, sizeof(uint16_t)) : NULL;
+    planes->epoch = 0;
+
+    if (planes->type == NULL || planes->energy == NULL || planes->age == NULL || planes->starve == NULL
+        || (with_acted && planes->acted == NULL)) {
+        return -1;
+    }
+    return 0;
+}
+
+void free_planes(const EcoSystem *ecoSystem, Planes *planes) {
+    plane_free(ecoSystem, planes->type, sizeof(uint8_t));
+    plane_free(ecoSystem, planes->energy, sizeof(uint16_t));
+    plane_free(ecoSystem, planes->age, sizeof(uint8_t));
+    plane_free(ecoSystem, planes->starve, sizeof(uint8_t));
+    plane_free(ecoSystem, planes->acted, sizeof(uint16_t));
+    *planes = (Planes){0};
+}
+
+// Function to empty one set of planes over cells [from, to)
+static void clear_planes(Planes *planes, size_t from, size_t to) {
+    if (planes->type == NULL) return;
+    memset(&planes->type[from], EMPTY, to - from);
+    memset(&planes->energy[from], 0, (to - from) * sizeof(uint16_t));
+    memset(&planes->age[from], 0, to - from);
+    memset(&planes->starve[from], 0, to - from);
+    if (planes->acted != NULL) memset(&planes->acted[from], 0, (to - from) * sizeof(uint16_t));
+}
+
+// Function to mark the ghost ring of the type planes off the grid, walls that nothing moves or spawns into.
+// A torus overwrites it with copies of the opposite edges every tick instead (see wrap_plane).
+static void ghost_fill(EcoSystem *ecoSystem) {
+    uint8_t *types[2] = {ecoSystem->grid.type, ecoSystem->back.type};
+
+    for (int p = 0; p < 2 && types[p] != NULL; p++) {
+        memset(&types[p][AT(ecoSystem, -1, -1)], OFF_GRID, (size_t) ecoSystem->stride);
+        memset(&types[p][AT(ecoSystem, ecoSystem->rows, -1)], OFF_GRID, (size_t) ecoSystem->stride);
+        for (int i = 0; i < ecoSystem->rows; i++) {
+            types[p][AT(ecoSystem, i, -1)] = OFF_GRID;
+            types[p][AT(ecoSystem, i, ecoSystem->cols)] = OFF_GRID;
+        }
+    }
+}
+
+// Function to write every per-cell array for the first time, each tile from the thread the work-stealing
+// scheduler deals it to first (see update_rows), so its pages land on that thread's NUMA node.
+// Leaves every cell EMPTY with its lock initialised, and the ghost ring off the grid.
+static void first_touch(EcoSystem *ecoSystem) {
+    int tile = ecoSystem->tile;
+    int tile_rows = (ecoSystem->rows + tile - 1) / tile;
+    int tile_cols = (ecoSystem->cols + tile - 1) / tile;
+    int tiles = tile_rows * tile_cols;
+
+    #pragma omp parallel
+    {
+        int threads = omp_get_num_threads(), self = omp_get_thread_num();
+        int first = (int) ((long long) tiles * self / threads);
+        int last = (int) ((long long) tiles * (self + 1) / threads);
+
+        for (int task = first; task < last; task++) {
+            int row = task / tile_cols * tile, col = task % tile_cols * tile;
+            int row_end = row + tile < ecoSystem->rows ? row + tile : ecoSystem->rows;
+            int col_end = col + tile < ecoSystem->cols ? col + tile : ecoSystem->cols;
+
+            for (int i = row; i < row_end; i++) {
+                size_t from = AT(ecoSystem, i, col), to = AT(ecoSystem, i, col_end);
+                clear_planes(&ecoSystem->grid, from, to);
+                clear_planes(&ecoSystem->back, from, to);
+                if (ecoSystem->intent != NULL) memset(&ecoSystem->intent[from], 0, to - from);
+                if (ecoSystem->claim != NULL) memset(&ecoSystem->claim[from], 0, to - from);
+                if (ecoSystem->agents.listed != NULL) memset(&ecoSystem->agents.listed[from], 0, to - from);
+                if (ecoSystem->plant_events.due != NULL) {
+                    memset(&ecoSystem->plant_events.due[from], 0, (to - from) * sizeof(uint32_t));
+                }
+                for (size_t c = from; ecoSystem->locks != NULL && c < to; c++) {
+                    omp_init_lock(&ecoSystem->locks[c]);
+                }
+            }
+        }
+    }
+    ghost_fill(ecoSystem);
+}
+
+// Function to pin every OpenMP thread to one CPU of the process's affinity mask, in order, so threads
+// with neighbouring numbers (and so neighbouring tiles) share a socket; returns the threads that failed
+static int pin_threads(void) {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return omp_get_max_threads();
+
+    static int cpus[CPU_SETSIZE];
+    int count = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &allowed)) cpus[count++] = cpu;
+    }
+
+    int failures = 0;
+    #pragma omp parallel reduction(+ : failures)
+    {
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(cpus[omp_get_thread_num() % count], &one);
+        failures += pthread_setaffinity_np(pthread_self(), sizeof(one), &one) != 0;
+    }
+    return failures;
+}
+
+// Function to find the NUMA node holding the page of an address, -1 if unknown
+static int page_node(const void *address) {
+    uintptr_t page_size = (uintptr_t) sysconf(_SC_PAGESIZE);
+    void *page = (void *) ((uintptr_t) address & ~(page_size - 1));
+    int node = -1;
+
+    return syscall(SYS_move_pages, 0, 1UL, &page, NULL, &node, 0) == 0 ? node : -1;
+}
+
+// Function to print which CPU runs every thread and on which nodes its tiles' memory landed
+void report_placement(const EcoSystem *ecoSystem) {
+    int tile = ecoSystem->tile;
+    int tile_cols = (ecoSystem->cols + tile - 1) / tile;
+    int tiles = (ecoSystem->rows + tile - 1) / tile * tile_cols;
+    static const char *backings[] = {"regular pages", "transparent huge pages", "reserved huge pages"};
+
+    printf("Grid memory: %s", backings[ecoSystem->huge_pages]);
+    if (ecoSystem->huge_page_fallbacks > 0) {
+        printf(" (%d blocks fell back to transparent huge pages)", ecoSystem->huge_page_fallbacks);
+    }
+    printf("\n");
+
+    #pragma omp parallel
+    {
+        int threads = omp_get_num_threads(), self = omp_get_thread_num();
+        int first = (int) ((long long) tiles * self / threads);
+        int last = (int) ((long long) tiles * (self + 1) / threads);
+
+        if (first < last) {
+            const uint8_t *first_cell = &ecoSystem->grid.type[AT(ecoSystem, first / tile_cols * tile, first % tile_cols * tile)];
+            const uint8_t *last_cell = &ecoSystem->grid.type[AT(ecoSystem, (last - 1) / tile_cols * tile, (last - 1) % tile_cols * tile)];
+            int cpu = sched_getcpu(), first_node = page_node(first_cell), last_node = page_node(last_cell);
+
+            #pragma omp critical
+            printf("Thread %d: cpu %d, tiles [%d, %d), memory on node %d to %d\n", self, cpu, first, last, first_node, last_node);
+        }
+    }
+}
+
+// Function to release the grid and the engine buffers
+void destroy_ecosystem(EcoSystem *ecoSystem) {
+    for (int i = 0; ecoSystem->locks != NULL && i < ecoSystem->rows; i++) {
+        for (int j = 0; j < ecoSystem->cols; j++) {
+            omp_destroy_lock(LOCK(ecoSystem, i, j));
+        }
+    }
+
+    free_planes(ecoSystem, &ecoSystem->grid);
+    plane_free(ecoSystem, ecoSystem->locks, sizeof(omp_lock_t));
+    free_planes(ecoSystem, &ecoSystem->back);
+    stats_free(&ecoSystem->stats);
+    for (int s = PLANT; s <= CARNIVORE; s++) {
+        free(ecoSystem->bits.species[s]);
+    }
+    plane_free(ecoSystem, ecoSystem->intent, sizeof(uint8_t));
+    plane_free(ecoSystem, ecoSystem->claim, sizeof(uint8_t));
+    free(ecoSystem->plant_masks);
+    free(ecoSystem->deques);
+    for (int s = PLANT; s <= CARNIVORE; s++) {
+        free(ecoSystem->agents.cells[s]);
+        for (int t = 0; ecoSystem->agents.found != NULL && t < ecoSystem->agents.threads; t++) {
+            free(ecoSystem->agents.found[t].cells[s]);
+        }
+    }
+    plane_free(ecoSystem, ecoSystem->agents.listed, sizeof(uint8_t));
+    free(ecoSystem->agents.found);
+    free(ecoSystem->agents.scratch);
+    free(ecoSystem->dirty.touched);
+    free(ecoSystem->dirty.checked);
+    free(ecoSystem->dirty.settled);
+    free(ecoSystem->dirty.plants);
+    free(ecoSystem->dirty.energy);
+    for (int s = 0; s < PLANT_WHEEL_SLOTS; s++) {
+        free(ecoSystem->plant_events.slot[s]);
+    }
+    for (int t = 0; ecoSystem->plant_events.buffers != NULL && t < ecoSystem->plant_events.threads; t++) {
+        free(ecoSystem->plant_events.buffers[t].born);
+        free(ecoSystem->plant_events.buffers[t].refile);
+        free(ecoSystem->plant_events.buffers[t].emptied);
+    }
+    free(ecoSystem->plant_events.buffers);
+    free(ecoSystem->plant_events.check);
+    free(ecoSystem->plant_events.scratch);
+    plane_free(ecoSystem, ecoSystem->plant_events.due, sizeof(uint32_t));
+    *ecoSystem = (EcoSystem){0};
+}
+
+// Function to allocate the grid and the buffers of the selected engine on the heap
+int create_ecosystem(EcoSystem *ecoSystem, const Config *config) {
+    *ecoSystem = (EcoSystem){0};
+    ecoSystem->rows = config->rows;
+    ecoSystem->cols = config->cols;
+    ecoSystem->stride = config->cols + 2;
+    ecoSystem->boundary = config->boundary;
+    ecoSystem->seed = config->seed;
+    ecoSystem->tile = config->tile;
+    ecoSystem->huge_pages = config->huge_pages;
+    ecoSystem->threads = omp_get_max_threads();
+    ecoSystem->deques = aligned_calloc(ecoSystem->threads, sizeof(TileDeque));
+    ecoSystem->plant_kernel = select_plant_kernel(config->simd, &ecoSystem->plant_kernel_name);
+    death_by_age_init(ecoSystem);
+    bool ok = stats_init(&ecoSystem->stats, omp_get_max_threads()) == 0 && ecoSystem->deques != NULL;
+    ok = alloc_planes(ecoSystem, &ecoSystem->grid, config->engine != ENGINE_BUFFERED) == 0 && ok;
+
+    if (config->engine == ENGINE_LOCKED || config->engine == ENGINE_SPARSE) {
+        ecoSystem->locks = plane_alloc(ecoSystem, sizeof(omp_lock_t));
+        ok = ok && ecoSystem->locks != NULL;
+    }
+    if (config->engine == ENGINE_SPARSE) {
+        ecoSystem->agents.threads = omp_get_max_threads();
+        ecoSystem->agents.listed = plane_alloc(ecoSystem, sizeof(uint8_t));
+        ecoSystem->agents.found = aligned_calloc(ecoSystem->agents.threads, sizeof(AgentBuffer));
+        ok = ok && ecoSystem->agents.listed != NULL && ecoSystem->agents.found != NULL;
+        if (config->plant_events) {
+            PlantEvents *events = &ecoSystem->plant_events;
+            events->threads = omp_get_max_threads();
+            events->due = plane_alloc(ecoSystem, sizeof(uint32_t));
+            events->buffers = aligned_calloc(events->threads, sizeof(PlantBuffer));
+            ok = ok && events->due != NULL && events->buffers != NULL;
+        }
+    } else if (config->engine == ENGINE_BUFFERED) {
+        ecoSystem->intent = plane_alloc(ecoSystem, sizeof(uint8_t));
+        ecoSystem->claim = plane_alloc(ecoSystem, sizeof(uint8_t));
+        ecoSystem->plant_masks = aligned_calloc((size_t) ecoSystem->threads * PLANT_MASK_STRIDE(config->cols),
+                                                sizeof(uint8_t));
+        ok = alloc_planes(ecoSystem, &ecoSystem->back, false) == 0 && ok
+             && ecoSystem->intent != NULL && ecoSystem->claim != NULL && ecoSystem->plant_masks != NULL;
+    }
+
+    if (config->dirty_tiles) {
+        DirtyTiles *dirty = &ecoSystem->dirty;
+        dirty->rows = (config->rows + config->tile - 1) / config->tile;
+        dirty->cols = (config->cols + config->tile - 1) / config->tile;
+        size_t tiles = (size_t) dirty->rows * dirty->cols;
+        dirty->touched = aligned_calloc(tiles, sizeof(*dirty->touched));
+        dirty->checked = aligned_calloc(tiles, sizeof(uint64_t));
+        dirty->settled = aligned_calloc(tiles, sizeof(bool));
+        dirty->plants = aligned_calloc(tiles, sizeof(long long));
+        dirty->energy = aligned_calloc(tiles, sizeof(long long));
+        ok = ok && dirty->touched != NULL && dirty->checked != NULL && dirty->settled != NULL && dirty->plants != NULL
+             && dirty->energy != NULL;
+    }
+
+    if (config->bitboard) {
+        ecoSystem->bits.words = (config->cols + 63) / 64;
+        for (int s = PLANT; s <= CARNIVORE; s++) {
+            ecoSystem->bits.species[s] = aligned_calloc((size_t) config->rows * ecoSystem->bits.words, sizeof(uint64_t));
+            ok = ok && ecoSystem->bits.species[s] != NULL;
+        }
+    }
+
+    if (!ok) {
+        plane_free(ecoSystem, ecoSystem->locks, sizeof(omp_lock_t));
+        ecoSystem->locks = NULL;   // Not initialised yet, nothing to destroy
+        destroy_ecosystem(ecoSystem);
+        return -1;
+    }
+
+    if (config->pin) {
+        int failures = pin_threads();
+        if (failures > 0) {
+            printf("Could not pin %d threads\n", failures);
+        }
+    }
+    first_touch(ecoSystem);
+    return 0;
+}
+
+// Function to initialize the ecosystem
+void init_ecosystem(EcoSystem *ecoSystem, const Config *config) {
+
+    // The grid is already empty, written in parallel by first_touch from create_ecosystem
+
+    Rng rng = rng_stream(ecoSystem->seed, RNG_INIT_TICK, 0);
+
+    // Add plants, herbivores and carnivores to the grid randomly
+    for(int i = 0; i < config->plants; i++) {
+        int x = rng_below(&rng, ecoSystem->rows);
+        int y = rng_below(&rng, ecoSystem->cols);
+
+        set_cell(ecoSystem, x, y, (Cell){2, 0, 0, false, PLANT});
+    }
+    for(int i = 0; i < config->herbivores; i++) {
+        int x = rng_below(&rng, ecoSystem->rows);
+        int y = rng_below(&rng, ecoSystem->cols);
+
+        while (TYPE(ecoSystem, x, y) != EMPTY) {
+            x = rng_below(&rng, ecoSystem->rows);
+            y = rng_below(&rng, ecoSystem->cols);
+        }
+
+        set_cell(ecoSystem, x, y, (Cell){1, 0, 0, false, HERBIVORE});
+    }
+    for(int i = 0; i < config->carnivores; i++) {
+        int x = rng_below(&rng, ecoSystem->rows);
+        int y = rng_below(&rng, ecoSystem->cols);
+
+        while (TYPE(ecoSystem, x, y) != EMPTY) {
+            x = rng_below(&rng, ecoSystem->rows);
+            y = rng_below(&rng, ecoSystem->cols);
+        }
+
+        set_cell(ecoSystem, x, y, (Cell){1, 0, 0, false, CARNIVORE});
+    }
+}
+
+// Checkpoints hold the tick boundary state: seed, next tick and the type, energy, age and starve planes.
+// The random streams are keyed by (seed, tick, cell) and `acted` only matches stamps of the running tick,
+// so nothing else is needed to continue bit-identically. With --plant-events a section follows the planes:
+// CHECKPOINT_PLANTS, the number of plants to check next tick, those cells (row * cols + col, uint32) in
+// check order and the due plane, relative to the checkpoint's tick (PLANT_DORMANT stays as it is).
+typedef struct {
+    char magic[8];
+    int32_t rows;
+    int32_t cols;
+    uint64_t seed;
+    uint64_t tick;       // First tick still to run
+    int32_t engine;      // Engine that wrote it; continuation is bit-identical with the same engine
+    int32_t boundary;    // Boundary it ran with (0, reflecting, in checkpoints from before the option)
+} CheckpointHeader;
+
+// Function to write a whole buffer to a file descriptor
+static int write_all(int fd, const void *data, size_t size) {
+    const char *bytes = data;
+
+    while (size > 0) {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0) return -1;
+        bytes += written;
+        size -= (size_t) written;
+    }
+    return 0;
+}
+
+// Function to write the cells of a plane of `size`-byte elements row by row, leaving out the ghost cells
+static int write_plane(int fd, const EcoSystem *ecoSystem, const void *plane, size_t size) {
+    const unsigned char *cells = plane;
+    int status = 0;
+
+    for (int i = 0; status == 0 && i < ecoSystem->rows; i++) {
+        status = write_all(fd, cells + AT(ecoSystem, i, 0) * (ptrdiff_t) size, (size_t) ecoSystem->cols * size);
+    }
+    return status;
+}
+
+// Function to write the plant events section of a checkpoint taken before `tick` (see CheckpointHeader)
+static int write_plant_events(int fd, const EcoSystem *ecoSystem, uint64_t tick) {
+    const PlantEvents *events = &ecoSystem->plant_events;
+    size_t cols = (size_t) ecoSystem->cols;
+    uint32_t *buffer = malloc((events->check_count > cols ? events->check_count : cols) * sizeof(uint32_t));
+    if (buffer == NULL) return -1;
+
+    uint64_t checks = events->check_count;
+    for (size_t k = 0; k < events->check_count; k++) {
+        uint32_t c = events->check[k];
+        buffer[k] = c / (uint32_t) ecoSystem->stride * (uint32_t) cols + c % (uint32_t) ecoSystem->stride;
+    }
+    int status = write_all(fd, CHECKPOINT_PLANTS, 8);
+    status = status == 0 ? write_all(fd, &checks, sizeof(checks)) : -1;
+    status = status == 0 ? write_all(fd, buffer, events->check_count * sizeof(uint32_t)) : -1;
+
+    for (int i = 0; status == 0 && i < ecoSystem->rows; i++) {
+        const uint32_t *due = &events->due[AT(ecoSystem, i, 0)];
+        for (size_t j = 0; j < cols; j++) {
+            buffer[j] = due[j] == PLANT_DORMANT ? PLANT_DORMANT : (uint32_t) (due[j] - tick);
+        }
+        status = write_all(fd, buffer, cols * sizeof(uint32_t));
+    }
+    free(buffer);
+    return status;
+}
+
+// Function to write a checkpoint to `path`, through a temporary file so a crash never leaves a partial one
+static int checkpoint_write(const EcoSystem *ecoSystem, const char *path, uint64_t tick, Engine engine) {
+    char temporary[272];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+
+    CheckpointHeader header = {
+        .magic = CHECKPOINT_MAGIC,
+        .rows = ecoSystem->rows,
+        .cols = ecoSystem->cols,
+        .seed = ecoSystem->seed,
+        .tick = tick,
+        .engine = engine,
+        .boundary = ecoSystem->boundary,
+    };
+
+    int fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return -1;
+
+    int status = write_all(fd, &header, sizeof(header));
+    status = status == 0 ? write_plane(fd, ecoSystem, ecoSystem->grid.type, sizeof(uint8_t)) : -1;
+    status = status == 0 ? write_plane(fd, ecoSystem, ecoSystem->grid.energy, sizeof(uint16_t)) : -1;
+    status = status == 0 ? write_plane(fd, ecoSystem, ecoSystem->grid.age, sizeof(uint8_t)) : -1;
+    status = status == 0 ? write_plane(fd, ecoSystem, ecoSystem->grid.starve, sizeof(uint8_t)) : -1;
+    if (ecoSystem->plant_events.threads > 0) {
+        status = status == 0 ? write_plant_events(fd, ecoSystem, tick) : -1;
+    }
+    status = close(fd) == 0 ? status : -1;
+
+    return status == 0 ? rename(temporary, path) : -1;
+}
+
+// Function to wait for the checkpoint child started by checkpoint_fork; returns -1 if it failed
+int checkpoint_wait(pid_t *child) {
+    int status = 0;
+
+    if (*child <= 0) return 0;
+    pid_t waited = waitpid(*child, &status, 0);
+    *child = 0;
+    return waited > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+// Function to checkpoint from a forked child: the child's copy-on-write view of the grid stays frozen at
+// this tick while the parent keeps simulating, so the parent only pays for the fork.
+// Falls back to writing in place if fork fails.
+int checkpoint_fork(const EcoSystem *ecoSystem, const char *path, uint64_t tick, Engine engine, pid_t *child) {
+    int status = checkpoint_wait(child);   // One checkpoint in flight at a time
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        _exit(checkpoint_write(ecoSystem, path, tick, engine) == 0 ? 0 : 1);
+    }
+    if (pid < 0) {
+        return checkpoint_write(ecoSystem, path, tick, engine) == 0 ? status : -1;
+    }
+
+    *child = pid;
+    return status;
+}
+
+// Function to read a checkpoint header and take its grid size and seed into the configuration
+int checkpoint_read_header(const char *path, Config *config, uint64_t *tick) {
+    FILE *file = fopen(path, "rb");
+    CheckpointHeader header;
+
+    if (file == NULL) {
+        fprintf(stderr, "Error opening checkpoint '%s'\n", path);
+        return -1;
+    }
+    size_t read = fread(&header, sizeof(header), 1, file);
+    fclose(file);
+
+    if (read != 1 || memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0
+        || header.rows < 1 || header.cols < 1) {
+        fprintf(stderr, "'%s' is not a checkpoint\n", path);
+        return -1;
+    }
+    if (header.engine != (int32_t) config->engine) {
+        fprintf(stderr, "Warning: '%s' was written by another engine, the continuation will differ\n", path);
+    }
+    if (header.boundary != (int32_t) config->boundary) {
+        fprintf(stderr, "Warning: '%s' was written with another boundary, the continuation will differ\n", path);
+    }
+
+    config->rows = header.rows;
+    config->cols = header.cols;
+    config->seed = header.seed;
+    *tick = header.tick;
+    return 0;
+}
+
+// Function to read the cells of a plane of `size`-byte elements row by row (see write_plane)
+static bool read_plane(FILE *file, EcoSystem *ecoSystem, void *plane, size_t size) {
+    unsigned char *cells = plane;
+    size_t cols = (size_t) ecoSystem->cols;
+    bool ok = true;
+
+    for (int i = 0; ok && i < ecoSystem->rows; i++) {
+        ok = fread(cells + AT(ecoSystem, i, 0) * (ptrdiff_t) size, size, cols, file) == cols;
+    }
+    return ok;
+}
+
+// Function to read the plant events section of a checkpoint taken before `tick` (see CheckpointHeader),
+// once its magic has been read
+static bool read_plant_events(FILE *file, EcoSystem *ecoSystem, uint64_t tick) {
+    PlantEvents *events = &ecoSystem->plant_events;
+    uint64_t checks;
+    bool ok = fread(&checks, sizeof(checks), 1, file) == 1 && checks <= (uint64_t) ecoSystem->rows * ecoSystem->cols;
+
+    events->check_count = 0;
+    for (uint64_t k = 0; ok && k < checks; k++) {
+        uint32_t cell;
+        ok = fread(&cell, sizeof(cell), 1, file) == 1 && cell < (uint64_t) ecoSystem->rows * ecoSystem->cols;
+        ok = ok && agent_push(&events->check, &events->check_count, &events->check_capacity,
+                              (uint32_t) AT(ecoSystem, cell / (uint32_t) ecoSystem->cols, cell % (uint32_t) ecoSystem->cols));
+    }
+
+    ok = ok && read_plane(file, ecoSystem, events->due, sizeof(uint32_t));
+    for (int i = 0; ok && i < ecoSystem->rows; i++) {
+        uint32_t *due = &events->due[AT(ecoSystem, i, 0)];
+        for (int j = 0; j < ecoSystem->cols; j++) {
+            if (due[j] != PLANT_DORMANT) due[j] = (uint32_t) (due[j] + tick);
+        }
+    }
+    return ok;
+}
+
+// Function to restore the grid of an ecosystem created from the checkpoint's configuration. With plant events
+// on, `plant_events` tells whether the checkpoint held their state too (see plant_events_restore).
+int checkpoint_load(EcoSystem *ecoSystem, const char *path, bool *plant_events) {
+    FILE *file = fopen(path, "rb");
+    CheckpointHeader header;
+
+    if (file == NULL) return -1;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1
+              && read_plane(file, ecoSystem, ecoSystem->grid.type, sizeof(uint8_t))
+              && read_plane(file, ecoSystem, ecoSystem->grid.energy, sizeof(uint16_t))
+              && read_plane(file, ecoSystem, ecoSystem->grid.age, sizeof(uint8_t))
+              && read_plane(file, ecoSystem, ecoSystem->grid.starve, sizeof(uint8_t));
+
+    char magic[8];
+    *plant_events = ok && fread(magic, sizeof(magic), 1, file) == 1 && memcmp(magic, CHECKPOINT_PLANTS, 8) == 0;
+    bool events_on = ecoSystem->plant_events.threads > 0;
+    if (*plant_events && events_on) {
+        ok = read_plant_events(file, ecoSystem, header.tick);
+    } else if (ok && events_on) {
+        fprintf(stderr, "Warning: '%s' holds no plant event state, the plants are scheduled afresh and the "
+                        "continuation will differ\n", path);
+    } else if (ok && *plant_events) {
+        fprintf(stderr, "Warning: '%s' was written with --plant-events, the continuation will differ\n", path);
+    }
+    fclose(file);
+
+    for (int i = 0; ok && i < ecoSystem->rows; i++) {
+        for (int j = 0; ok && j < ecoSystem->cols; j++) {
+            ok = TYPE(ecoSystem, i, j) <= EMPTY;
+        }
+    }
+    if (!ok) {
+        fprintf(stderr, "Checkpoint '%s' is truncated or corrupt\n", path);
+        return -1;
+    }
+
+    ecoSystem->tick = header.tick;
+    return 0;
+}
+
+// Function to fold `bytes` bytes into a running hash, eight at a time
+static inline uint64_t hash_bytes(uint64_t hash, const void *data, size_t bytes) {
+    const uint8_t *p = data;
+    size_t k = 0;
+    for (; k + sizeof(uint64_t) <= bytes; k += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, p + k, sizeof(word));
+        hash = rng_mix(hash ^ word);
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, p + k, bytes - k);
+    return rng_mix(hash ^ tail ^ ((uint64_t) bytes << 56));
+}
+
+// Function to hash the type, energy, age and starve planes (the state a checkpoint keeps). Rows are
+// hashed in parallel, each keyed by its index, and combined with XOR, so the result does not depend on
+// the thread count.
+uint64_t state_hash(const EcoSystem *ecoSystem) {
+    int cols = ecoSystem->cols;
+    uint64_t hash = 0;
+
+    #pragma omp parallel for schedule(static) reduction(^ : hash)
+    for (int i = 0; i < ecoSystem->rows; i++) {
+        size_t row = AT(ecoSystem, i, 0);
+        uint64_t h = rng_mix((uint64_t) i + RNG_GAMMA);
+        h = hash_bytes(h, &ecoSystem->grid.type[row], (size_t) cols * sizeof(uint8_t));
+        h = hash_bytes(h, &ecoSystem->grid.energy[row], (size_t) cols * sizeof(uint16_t));
+        h = hash_bytes(h, &ecoSystem->grid.age[row], (size_t) cols * sizeof(uint8_t));
+        h = hash_bytes(h, &ecoSystem->grid.starve[row], (size_t) cols * sizeof(uint8_t));
+        hash ^= h;
+    }
+    return hash;
+}
+
+// Function to compare the hash of `tick` with a reference written by --hash. Returns 1 on a match, 0 on a
+// mismatch and -1 once the reference has no line for the tick.
+int hash_check(FILE *reference, int tick, uint64_t hash) {
+    int ref_tick;
+    unsigned long long ref_hash;
+
+    long line = ftell(reference);
+    while (fscanf(reference, "%d %llx", &ref_tick, &ref_hash) == 2) {
+        if (ref_tick == tick) return ref_hash == hash;
+        if (ref_tick > tick) {
+            fseek(reference, line, SEEK_SET);   // Keep the line for its own tick
+            break;
+        }
+        line = ftell(reference);
+    }
+    return -1;
+}
+
+// Function to print the state of the grid
+void print_grid(const EcoSystem *ecoSystem) {
+    for (int t = 0; t < ecoSystem->rows; t++) {
+        for (int k = 0; k < ecoSystem->cols; k++) {
+            switch (TYPE(ecoSystem, t, k)) {
+                case EMPTY:
+                    printf(" %sE%s ", COLOR_EMPTY, COLOR_RESET);
+                    break;
+                case PLANT:
+                    printf(" %sP%s ", COLOR_PLANT, COLOR_RESET);
+                    break;
+                case HERBIVORE:
+                    printf(" %sH%s ", COLOR_HERBIVORE, COLOR_RESET);
+                    break;
+                case CARNIVORE:
+                    printf(" %sC%s ", COLOR_CARNIVORE, COLOR_RESET);
+                    break;
+            }
+        }
+        printf("\n");
+    }
+}
+
+// Function to print the command line help
+void usage(const char *program) {
+    printf("Usage: %s [options]\n", program);
+    printf("  -c, --config FILE      read 'key = value' settings from FILE\n");
+    printf("  -s, --size N           square grid of N x N cells (default %d)\n", GRID_SIZE);
+    printf("      --rows N           number of grid rows\n");
+    printf("      --cols N           number of grid columns\n");
+    printf("  -p, --plants N         initial plants (default %d)\n", PLANTS);
+    printf("  -H, --herbivores N     initial herbivores (default %d)\n", HERBIVORES);
+    printf("  -C, --carnivores N     initial carnivores (default %d)\n", CARNIVORES);
+    printf("  -t, --max-ticks N      number of iterations (default %d)\n", MAX_TICKS);
+    printf("  -d, --debug-tick N     print the grid every N ticks, 0 disables (default %d)\n", DEBUG_TICK);
+    printf("  -S, --seed N           seed of the random streams (default %d)\n", SEED);
+    printf("      --reproduction N   chance (%%) that a plant spawns into an empty neighbour (default 50)\n");
+    printf("  -e, --engine NAME      'locked' (per-cell locks, default), 'buffered' (lock-free double buffer)\n");
+    printf("                         'tiles' (lock-free checkerboard of tiles) or 'sparse' (per-cell locks,\n");
+    printf("                         visiting only the cells in per-species agent lists) or 'batched'\n");
+    printf("                         (ensembles only: the buffered rules on %d replicas of one grid size\n",
+           BATCH_LANES);
+    printf("                         at once, one per SIMD lane)\n");
+    printf("      --tile N           tile side of the locked and tiles engines, at least 2 (default %d)\n", TILE_SIZE);
+    printf("      --simd NAME        plant kernel instruction set: auto (default), avx2, sse2 or scalar\n");
+    printf("      --log FILE         per-tick population log (default iter.log)\n");
+    printf("      --log-format FMT   'text' (default) or 'binary' (16-byte records, see log2txt)\n");
+    printf("      --snapshot FILE    write the grid dumps to FILE as compact binary snapshots (see snap2txt)\n");
+    printf("      --snapshot-encoding E  snapshot payload: 'raw', 'rle' or 'delta' (default)\n");
+    printf("      --checkpoint FILE  write the full state to FILE every --checkpoint-every ticks (from a\n");
+    printf("                         forked child, so the simulation does not wait for the disk)\n");
+    printf("      --checkpoint-every N  ticks between checkpoints (default 1000)\n");
+    printf("      --resume FILE      continue from a checkpoint; its grid size and seed replace the settings\n");
+    printf("      --workers N        split the grid into N horizontal strips run by N processes (locked engine\n");
+    printf("                         only, no grid dumps, snapshots or checkpoints)\n");
+    printf("      --huge-pages MODE  back the grid with 'off' (default), 'thp' (transparent) or 'explicit'\n");
+    printf("                         (reserved, MAP_HUGETLB) huge pages\n");
+    printf("      --pin              pin every thread to one CPU and report where its tiles are placed\n");
+    printf("      --bench            print 'bench ticks=N seconds=S' for the tick loop when the run ends\n");
+    printf("      --trace FILE       per-thread phase times, lock waits and load imbalance of every tick\n");
+    printf("                         (builds with ECO_TRACE only)\n");
+    printf("      --trace-format F   'chrome' (trace event JSON, default) or 'csv'\n");
+    printf("      --deterministic    bit-identical grid at every tick for any thread count; the locked and\n");
+    printf("                         sparse engines are replaced by 'tiles'\n");
+    printf("      --hash FILE        write a hash of the grid after every tick\n");
+    printf("      --hash-check FILE  compare every tick with the hashes of a --hash run (e.g. a 1-thread\n");
+    printf("                         reference) and stop with an error at the first difference\n");
+    printf("      --ensemble FILE    run one independent world per line of FILE ('key=value' overrides of\n");
+    printf("                         size, rows, cols, plants, herbivores, carnivores, max_ticks, seed,\n");
+    printf("                         reproduction, engine, tile, simd, bitboard), one per thread at a time\n");
+    printf("      --replicas N       run N copies of the settings with seeds seed, seed+1, ... as an ensemble\n");
+    printf("      --ensemble-out F   per-replica tick statistics of an ensemble (default ensemble.csv)\n");
+    printf("      --stats FILE       write births, deaths by cause, moves and energy per species to a CSV\n");
+    printf("      --bitboard         count species with popcount over per-species bit planes; the buffered\n");
+    printf("                         engine also takes its plant neighbourhoods from them\n");
+    printf("      --dirty-tiles      locked and tiles engines: skip the tiles where nothing can happen until\n");
+    printf("                         something next to them changes\n");
+    printf("      --plant-events     sparse engine: schedule every plant's next reproduction ahead on a timing\n");
+    printf("                         wheel and check overpopulation only when a plant appears next to it\n");
+    printf("      --boundary MODE    'reflect' (walls, default) or 'torus' (opposite edges are neighbours,\n");
+    printf("                         buffered engine only)\n");
+    printf("  -h, --help             show this help\n");
+    printf("Config file keys: size, rows, cols, plants, herbivores, carnivores, max_ticks, debug_tick, seed, engine,\n");
+    printf("                  tile, simd, bitboard (0 or 1), dirty_tiles (0 or 1), plant_events (0 or 1), boundary,\n");
+    printf("                  stats, log, log_format, snapshot, snapshot_encoding, checkpoint, checkpoint_every,\n");
+    printf("                  resume, workers, huge_pages, pin (0 or 1), bench (0 or 1), trace, trace_format,\n");
+    printf("                  deterministic (0 or 1), hash, hash_check, reproduction, ensemble,\n");
+    printf("                  replicas, ensemble_out\n");
+}
+
+// Function to parse a non-negative integer setting
+int parse_count(const char *name, const char *value, int *out) {
+    char *end;
+    long parsed = strtol(value, &end, 10);
+
+    if (end == value || *end != '\0' || parsed < 0 || parsed > 1000000000L) {
+        fprintf(stderr, "Invalid value for %s: '%s'\n", name, value);
+        return -1;
+    }
+
+    *out = (int) parsed;
+    return 0;
+}
+
+// Function to parse a 64-bit seed
+int parse_seed(const char *value, uint64_t *out) {
+    char *end;
+    unsigned long long parsed = strtoull(value, &end, 0);
+
+    if (end == value || *end != '\0') {
+        fprintf(stderr, "Invalid value for seed: '%s'\n", value);
+        return -1;
+    }
+
+    *out = parsed;
+    return 0;
+}
+
+// Function to apply one named setting to the configuration
+int apply_setting(Config *config, const char *key, const char *value) {
+    if (strcmp(key, "size") == 0) {
+        if (parse_count(key, value, &config->rows) != 0) return -1;
+        config->cols = config->rows;
+        return 0;
+    }
+    if (strcmp(key, "rows") == 0) return parse_count(key, value, &config->rows);
+    if (strcmp(key, "cols") == 0) return parse_count(key, value, &config->cols);
+    if (strcmp(key, "plants") == 0) return parse_count(key, value, &config->plants);
+    if (strcmp(key, "herbivores") == 0) return parse_count(key, value, &config->herbivores);
+    if (strcmp(key, "carnivores") == 0) return parse_count(key, value, &config->carnivores);
+    if (strcmp(key, "max_ticks") == 0) return parse_count(key, value, &config->max_ticks);
+    if (strcmp(key, "debug_tick") == 0) return parse_count(key, value, &config->debug_tick);
+    if (strcmp(key, "reproduction") == 0) return parse_count(key, value, &config->reproduction);
+    if (strcmp(key, "replicas") == 0) return parse_count(key, value, &config->replicas);
+    if (strcmp(key, "ensemble") == 0) {
+        snprintf(config->ensemble_path, sizeof(config->ensemble_path), "%s", value);
+        return 0;
+    }
+    if (strcmp(key, "ensemble_out") == 0) {
+        snprintf(config->ensemble_out, sizeof(config->ensemble_out), "%s", value);
+        return 0;
+    }
+    if (strcmp(key, "seed") == 0) return parse_seed(value, &config->seed);
+    if (strcmp(key, "tile") == 0) return parse_count(key, value, &config->tile);
+    if (strcmp(key, "log") == 0) {
+        snprintf(config->log_path, sizeof(config->log_path), "%s", value);
+        return 0;
+    }
+    if (strcmp(key, "log_format") == 0) {
+        if (strcmp(value, "text") == 0) {
+            config->log_format = LOG_TEXT;
+        } else if (strcmp(value, "binary") == 0) {
+            config->log_format = LOG_BINARY;
+        } else {
+            fprintf(stderr, "Unknown log format '%s'\n", value);
+            return -1;
+        }
+        return 0;
+    }
+    if (strcmp(key, "snapshot") == 0) {
+        snprintf(config->snapshot_path, sizeof(config->snapshot_path), "%s", value);
+        return 0;
+    }
+    if (strcmp(key, "snapshot_encoding") == 0) {
+        static const char *encodings[] = {"raw", "rle", "delta"};
+        for (int e = 0; e < 3; e++) {
+            if (strcmp(value, encodings[e]) == 0) {
+                config->snapshot_encoding = (SnapshotEncoding) e;
+                return 0;
+            }
+        }
+        fprintf(stderr, "Unknown snapshot encoding '%s'\n", value);
+        return -1;
+    }
+    if (strcmp(key, "checkpoint") == 0) {
+        snprintf(config->checkpoint_path, sizeof(config->checkpoint_path), "%s", value);
+        return 0;
+    }
+    if (strcmp(key, "workers") == 0) return parse_count(key, value, &config->workers);
+    if (strcmp(key, "pin") == 0) {
+        int enabled;
+        if (parse_count(key, value, &enabled) != 0) return -1;
+        config->pin = enabled != 0;
+        return 0;
+    }
+    if (strcmp(key, "trace") == 0) {
+        snprintf(config->trace_path, sizeof(config->trace_path), "%s", value);
+        return 0;
+    }
+    if (strcmp(key, "trace_format") == 0) {
+        if (strcmp(value, "chrome") == 0) {
+            config->trace_format = TRACE_CHROME;
+        } else if (strcmp(value, "csv") == 0) {
+            config->trace_format = TRACE_CSV;
+        } else {
+            fprintf(stderr, "Unknown trace format '%s'\n", value);
+            return -1;
+        }
+        return 0;
+    }
+    if (strcmp(key, "deterministic") == 0) {
+        int enabled;
+        if (parse_count(key, value, &enabled) != 0) return -1;
+        config->deterministic = enabled != 0;
+        return 0;
+    }
+    if (strcmp(key, "hash") == 0) {
+        snprintf(config->hash_path, sizeof(config->hash_path), "%s", value);
+        return 0;
+    }
+    if (strcmp(key, "hash_check") == 0) {
+        snprintf(config->hash_check_path, sizeof(config->hash_check_path), "%s", value);
+        return 0;
+    }
+    if (strcmp(key, "bench") == 0) {
+        int enabled;
+        if (parse_count(key, value, &enabled) != 0) return -1;
+        config->bench = enabled != 0;
+        return 0;
+    }
+    if (strcmp(key, "huge_pages") == 0) {
+        static const char *backings[] = {"off", "thp", "explicit"};
+        for (int b = 0; b < 3; b++) {
+            if (strcmp(value, backings[b]) == 0) {
+                config->huge_pages = (HugePages) b;
+                return 0;
+            }
+        }
+        fprintf(stderr, "Unknown huge page mode '%s'\n", value);
+        return -1;
+    }
+    if (strcmp(key, "checkpoint_every") == 0) return parse_count(key, value, &config->checkpoint_every);
+    if (strcmp(key, "resume") == 0) {
+        snprintf(config->resume_path, sizeof(config->resume_path), "%s", value);
+        return 0;
+    }
+    if (strcmp(key, "stats") == 0) {
+        snprintf(config->stats_path, sizeof(config->stats_path), "%s", value);
+        return 0;
+    }
+    if (strcmp(key, "bitboard") == 0) {
+        int enabled;
+        if (parse_count(key, value, &enabled) != 0) return -1;
+        config->bitboard = enabled != 0;
+        return 0;
+    }
+    if (strcmp(key, "dirty_tiles") == 0) {
+        int enabled;
+        if (parse_count(key, value, &enabled) != 0) return -1;
+        config->dirty_tiles = enabled != 0;
+        return 0;
+    }
+    if (strcmp(key, "plant_events") == 0) {
+        int enabled;
+        if (parse_count(key, value, &enabled) != 0) return -1;
+        config->plant_events = enabled != 0;
+        return 0;
+    }
+    if (strcmp(key, "boundary") == 0) {
+        if (strcmp(value, "reflect") == 0) {
+            config->boundary = BOUNDARY_REFLECT;
+        } else if (strcmp(value, "torus") == 0) {
+            config->boundary = BOUNDARY_TORUS;
+        } else {
+            fprintf(stderr, "Unknown boundary '%s'\n", value);
+            return -1;
+        }
+        return 0;
+    }
+    if (strcmp(key, "simd") == 0) {
+        static const char *levels[] = {"auto", "avx2", "sse2", "scalar"};
+        for (int l = 0; l < 4; l++) {
+            if (strcmp(value, levels[l]) == 0) {
+                config->simd = (SimdLevel) l;
+                return 0;
+            }
+        }
+        fprintf(stderr, "Unknown instruction set '%s'\n", value);
+        return -1;
+    }
+    if (strcmp(key, "engine") == 0) {
+        if (strcmp(value, "locked") == 0) {
+            config->engine = ENGINE_LOCKED;
+        } else if (strcmp(value, "buffered") == 0) {
+            config->engine = ENGINE_BUFFERED;
+        } else if (strcmp(value, "tiles") == 0) {
+            config->engine = ENGINE_TILES;
+        } else if (strcmp(value, "sparse") == 0) {
+            config->engine = ENGINE_SPARSE;
+        } else if (strcmp(value, "batched") == 0) {
+            config->engine = ENGINE_BATCHED;
+        } else {
+            fprintf(stderr, "Unknown engine '%s'\n", value);
+            return -1;
+        }
+        return 0;
+    }
+
+    fprintf(stderr, "Unknown setting '%s'\n", key);
+    return -1;
+}
+
+// Function to read 'key = value' lines from a config file ('#' starts a comment)
+int load_config_file(Config *config, const char *path) {
+    FILE *file = fopen(path, "r");
+
+    if (file == NULL) {
+        fprintf(stderr, "Error opening config file '%s'\n", path);
+        return -1;
+    }
+
+    char line[256];
+    int line_number = 0;
+    int status = 0;
+
+    while (status == 0 && fgets(line, sizeof(line), file) != NULL) {
+        line_number++;
+
+        char *comment = strchr(line, '#');
+        if (comment != NULL) *comment = '\0';
+
+        char key[64], value[192];
+        int fields = sscanf(line, " %63[^= \t] = %191s", key, value);
+
+        if (fields == EOF || fields == 0) {
+            continue;  // Blank or comment-only line
+        }
+        if (fields != 2) {
+            fprintf(stderr, "%s:%d: expected 'key = value'\n", path, line_number);
+            status = -1;
+        } else {
+            status = apply_setting(config, key, value);
+        }
+    }
+
+    fclose(file);
+    return status;
+}
+
+// Function to validate a configuration, and to switch to the tiles engine in deterministic mode
+int check_config(Config *config) {
+    if (config->rows < 1 || config->cols < 1) {
+        fprintf(stderr, "The grid needs at least one row and one column\n");
+        return -1;
+    }
+
+    if (config->checkpoint_path[0] != '\0' && config->checkpoint_every < 1) {
+        fprintf(stderr, "Checkpoints need --checkpoint-every of at least 1\n");
+        return -1;
+    }
+
+    if (config->workers < 1 || config->workers > MAX_WORKERS) {
+        fprintf(stderr, "Between 1 and %d workers are supported\n", MAX_WORKERS);
+        return -1;
+    }
+    if (config->workers > 1) {
+        if (config->engine != ENGINE_LOCKED || config->bitboard || config->dirty_tiles || config->snapshot_path[0] != '\0'
+            || config->checkpoint_path[0] != '\0' || config->resume_path[0] != '\0' || config->bench
+            || config->trace_path[0] != '\0' || config->deterministic || config->hash_path[0] != '\0'
+            || config->hash_check_path[0] != '\0') {
+            fprintf(stderr, "--workers runs the locked engine, without bitboards, dirty tiles, snapshots, checkpoints,\n"
+                            "--bench, --trace, --deterministic or state hashes\n");
+            return -1;
+        }
+        if (config->rows < 4 * config->workers) {
+            fprintf(stderr, "Every worker needs a strip of at least 4 rows\n");
+            return -1;
+        }
+    }
+
+    // The locked and sparse engines let threads race for cells; the tiles engine runs the same in-place
+    // rules without races, and the buffered engine never has any
+    if (config->deterministic && (config->engine == ENGINE_LOCKED || config->engine == ENGINE_SPARSE)) {
+        config->engine = ENGINE_TILES;
+    }
+
+    if (config->dirty_tiles && config->engine != ENGINE_LOCKED && config->engine != ENGINE_TILES) {
+        fprintf(stderr, "--dirty-tiles needs the locked or tiles engine\n");
+        return -1;
+    }
+    if (config->plant_events && config->engine != ENGINE_SPARSE) {
+        fprintf(stderr, "--plant-events needs the sparse engine\n");
+        return -1;
+    }
+
+    // The ghost cells of a torus are copies, only exact while nothing writes the grid during a sweep. The
+    // in-place engines would read stale copies of the opposite edge (and the tiles engine's colouring does
+    // not wrap), so only the buffered engine, which writes into the back buffer, runs on a torus.
+    if (config->boundary == BOUNDARY_TORUS && config->engine != ENGINE_BUFFERED) {
+        fprintf(stderr, "--boundary torus needs the buffered engine\n");
+        return -1;
+    }
+
+#ifndef ECO_TRACE
+    if (config->trace_path[0] != '\0') {
+        fprintf(stderr, "--trace needs a build with ECO_TRACE (the MiniProyecto_1_trace target)\n");
+        return -1;
+    }
+#endif
+
+    if (config->tile < 2) {
+        fprintf(stderr, "Tiles must be at least 2 cells wide\n");
+        return -1;
+    }
+
+    if (config->reproduction > 100) {
+        fprintf(stderr, "The reproduction chance is a percentage, at most 100\n");
+        return -1;
+    }
+
+    // The agent lists hold AT indices, ghost columns included
+    long long cells = (long long) config->rows * config->cols;
+    if (config->engine == ENGINE_SPARSE && (long long) config->rows * (config->cols + 2) > UINT32_MAX) {
+        fprintf(stderr, "The sparse engine indexes at most %u cells, ghost columns included\n", UINT32_MAX);
+        return -1;
+    }
+
+    if (config->resume_path[0] == '\0'
+        && (long long) config->plants + config->herbivores + config->carnivores > cells) {
+        fprintf(stderr, "Initial populations do not fit in a %dx%d grid\n", config->rows, config->cols);
+        return -1;
+    }
+
+    return 0;
+}
+
+// Function to build the configuration from the defaults and the command line
+int parse_config(Config *config, int argc, char **argv) {
+    *config = (Config){
+        .rows = GRID_SIZE,
+        .cols = GRID_SIZE,
+        .plants = PLANTS,
+        .herbivores = HERBIVORES,
+        .carnivores = CARNIVORES,
+        .max_ticks = MAX_TICKS,
+        .debug_tick = DEBUG_TICK,
+        .reproduction = 50,
+        .seed = SEED,
+        .engine = ENGINE_LOCKED,
+        .tile = TILE_SIZE,
+        .simd = SIMD_AUTO,
+        .log_path = "iter.log",
+        .log_format = LOG_TEXT,
+        .snapshot_encoding = SNAPSHOT_DELTA,
+        .checkpoint_every = 1000,
+        .workers = 1,
+        .ensemble_out = "ensemble.csv",
+    };
+
+    enum { OPT_ROWS = 256, OPT_COLS, OPT_TILE, OPT_SIMD, OPT_BITBOARD, OPT_DIRTY_TILES, OPT_PLANT_EVENTS, OPT_BOUNDARY,
+           OPT_STATS, OPT_LOG, OPT_LOG_FORMAT, OPT_SNAPSHOT, OPT_SNAPSHOT_ENCODING, OPT_CHECKPOINT, OPT_CHECKPOINT_EVERY, OPT_RESUME,
+           OPT_WORKERS, OPT_HUGE_PAGES, OPT_PIN, OPT_BENCH, OPT_TRACE, OPT_TRACE_FORMAT,
+           OPT_DETERMINISTIC, OPT_HASH, OPT_HASH_CHECK,
+           OPT_REPRODUCTION, OPT_ENSEMBLE, OPT_REPLICAS, OPT_ENSEMBLE_OUT };
+    static const struct option options[] = {
+        {"config", required_argument, NULL, 'c'},
+        {"size", required_argument, NULL, 's'},
+        {"rows", required_argument, NULL, OPT_ROWS},
+        {"cols", required_argument, NULL, OPT_COLS},
+        {"plants", required_argument, NULL, 'p'},
+        {"herbivores", required_argument, NULL, 'H'},
+        {"carnivores", required_argument, NULL, 'C'},
+        {"max-ticks", required_argument, NULL, 't'},
+        {"debug-tick", required_argument, NULL, 'd'},
+        {"seed", required_argument, NULL, 'S'},
+        {"engine", required_argument, NULL, 'e'},
+        {"tile", required_argument, NULL, OPT_TILE},
+        {"simd", required_argument, NULL, OPT_SIMD},
+        {"bitboard", no_argument, NULL, OPT_BITBOARD},
+        {"dirty-tiles", no_argument, NULL, OPT_DIRTY_TILES},
+        {"plant-events", no_argument, NULL, OPT_PLANT_EVENTS},
+        {"boundary", required_argument, NULL, OPT_BOUNDARY},
+        {"stats", required_argument, NULL, OPT_STATS},
+        {"log", required_argument, NULL, OPT_LOG},
+        {"log-format", required_argument, NULL, OPT_LOG_FORMAT},
+        {"snapshot", required_argument, NULL, OPT_SNAPSHOT},
+        {"snapshot-encoding", required_argument, NULL, OPT_SNAPSHOT_ENCODING},
+        {"checkpoint", required_argument, NULL, OPT_CHECKPOINT},
+        {"checkpoint-every", required_argument, NULL, OPT_CHECKPOINT_EVERY},
+        {"resume", required_argument, NULL, OPT_RESUME},
+        {"workers", required_argument, NULL, OPT_WORKERS},
+        {"huge-pages", required_argument, NULL, OPT_HUGE_PAGES},
+        {"pin", no_argument, NULL, OPT_PIN},
+        {"bench", no_argument, NULL, OPT_BENCH},
+        {"trace", required_argument, NULL, OPT_TRACE},
+        {"trace-format", required_argument, NULL, OPT_TRACE_FORMAT},
+        {"deterministic", no_argument, NULL, OPT_DETERMINISTIC},
+        {"hash", required_argument, NULL, OPT_HASH},
+        {"hash-check", required_argument, NULL, OPT_HASH_CHECK},
+        {"reproduction", required_argument, NULL, OPT_REPRODUCTION},
+        {"ensemble", required_argument, NULL, OPT_ENSEMBLE},
+        {"replicas", required_argument, NULL, OPT_REPLICAS},
+        {"ensemble-out", required_argument, NULL, OPT_ENSEMBLE_OUT},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+
+    // Settings are applied in order, so later options override a config file given earlier
+    int opt;
+    int status = 0;
+    while (status == 0 && (opt = getopt_long(argc, argv, "c:s:p:H:C:t:d:S:e:h", options, NULL)) != -1) {
+        switch (opt) {
+            case 'c': status = load_config_file(config, optarg); break;
+            case 's': status = apply_setting(config, "size", optarg); break;
+            case OPT_ROWS: status = apply_setting(config, "rows", optarg); break;
+            case OPT_COLS: status = apply_setting(config, "cols", optarg); break;
+            case 'p': status = apply_setting(config, "plants", optarg); break;
+            case 'H': status = apply_setting(config, "herbivores", optarg); break;
+            case 'C': status = apply_setting(config, "carnivores", optarg); break;
+            case 't': status = apply_setting(config, "max_ticks", optarg); break;
+            case 'd': status = apply_setting(config, "debug_tick", optarg); break;
+            case 'S': status = apply_setting(config, "seed", optarg); break;
+            case 'e': status = apply_setting(config, "engine", optarg); break;
+            case OPT_TILE: status = apply_setting(config, "tile", optarg); break;
+            case OPT_SIMD: status = apply_setting(config, "simd", optarg); break;
+            case OPT_BITBOARD: status = apply_setting(config, "bitboard", "1"); break;
+            case OPT_DIRTY_TILES: status = apply_setting(config, "dirty_tiles", "1"); break;
+            case OPT_PLANT_EVENTS: status = apply_setting(config, "plant_events", "1"); break;
+            case OPT_BOUNDARY: status = apply_setting(config, "boundary", optarg); break;
+            case OPT_STATS: status = apply_setting(config, "stats", optarg); break;
+            case OPT_LOG: status = apply_setting(config, "log", optarg); break;
+            case OPT_LOG_FORMAT: status = apply_setting(config, "log_format", optarg); break;
+            case OPT_SNAPSHOT: status = apply_setting(config, "snapshot", optarg); break;
+            case OPT_SNAPSHOT_ENCODING: status = apply_setting(config, "snapshot_encoding", optarg); break;
+            case OPT_CHECKPOINT: status = apply_setting(config, "checkpoint", optarg); break;
+            case OPT_CHECKPOINT_EVERY: status = apply_setting(config, "checkpoint_every", optarg); break;
+            case OPT_RESUME: status = apply_setting(config, "resume", optarg); break;
+            case OPT_WORKERS: status = apply_setting(config, "workers", optarg); break;
+            case OPT_HUGE_PAGES: status = apply_setting(config, "huge_pages", optarg); break;
+            case OPT_PIN: status = apply_setting(config, "pin", "1"); break;
+            case OPT_BENCH: status = apply_setting(config, "bench", "1"); break;
+            case OPT_TRACE: status = apply_setting(config, "trace", optarg); break;
+            case OPT_TRACE_FORMAT: status = apply_setting(config, "trace_format", optarg); break;
+            case OPT_DETERMINISTIC: status = apply_setting(config, "deterministic", "1"); break;
+            case OPT_HASH: status = apply_setting(config, "hash", optarg); break;
+            case OPT_HASH_CHECK: status = apply_setting(config, "hash_check", optarg); break;
+            case OPT_REPRODUCTION: status = apply_setting(config, "reproduction", optarg); break;
+            case OPT_ENSEMBLE: status = apply_setting(config, "ensemble", optarg); break;
+            case OPT_REPLICAS: status = apply_setting(config, "replicas", optarg); break;
+            case OPT_ENSEMBLE_OUT: status = apply_setting(config, "ensemble_out", optarg); break;
+            case 'h': usage(argv[0]); exit(0);
+            default: status = -1; break;
+        }
+    }
+
+    if (status != 0 || optind < argc) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    if (config->ensemble_path[0] != '\0' || config->replicas > 0) {
+        if (config->ensemble_path[0] != '\0' && config->replicas > 0) {
+            fprintf(stderr, "Give either --ensemble or --replicas\n");
+            return -1;
+        }
+        if (config->workers > 1 || config->pin || config->bench || config->snapshot_path[0] != '\0'
+            || config->checkpoint_path[0] != '\0' || config->resume_path[0] != '\0'
+            || config->trace_path[0] != '\0' || config->hash_path[0] != '\0' || config->hash_check_path[0] != '\0') {
+            fprintf(stderr, "Ensembles run without --workers, --pin, --bench, snapshots, checkpoints, traces or hashes\n");
+            return -1;
+        }
+    } else if (config->engine == ENGINE_BATCHED) {
+        fprintf(stderr, "The batched engine only runs ensembles (--ensemble or --replicas)\n");
+        return -1;
+    }
+
+    return check_config(config);
+}
+
+// ---------------------------------------------------------------------------
+// Distributed mode (--workers N)
+//
+// The grid is cut into N horizontal strips, each owned by one worker process
+// with its own EcoSystem: the strip plus a ghost row above and below (none at
+// the edges of the grid). Every worker runs the locked update functions in two
+// phases per tick, first the upper half of its strip and then the lower half.
+// Agents only touch cells at distance 1 and both halves have at least 2 rows,
+// so within a phase the only cells two workers share are a ghost row and the
+// owner's boundary row, which the owner leaves alone during that phase:
+//
+//   1. send the last row down, receive the top ghost          (halo)
+//   2. update the upper half, which may write into the top ghost
+//   3. send the top ghost back up, take the last row back     (migration)
+//   4. send the first row up, receive the bottom ghost        (halo)
+//   5. update the lower half, which may write into the bottom ghost
+//   6. send the bottom ghost back down, take the first row back (migration)
+//
+// Agents that moved or were born across a strip edge come back to their new
+// owner with the ghost row. Rows travel through single-producer single-consumer
+// rings in shared memory, one per direction between neighbouring strips. The
+// per-tick statistics go through shared slots and a process-shared barrier, so
+// every worker takes the same early-stop decision; worker 0 writes the log.
+// Random streams are keyed by global cell, as in the single-process engines.
+// ---------------------------------------------------------------------------
+
+#define HALO_SLOTS 4   // Rows in flight per ring, at most 2 per tick are queued
+#define HALO_ROW_BYTES(cols) ((size_t) (cols) * (3 * sizeof(uint8_t) + 2 * sizeof(uint16_t)))
+
+// One direction of a link between neighbouring strips
+typedef struct {
+    _Alignas(STATS_CACHE_LINE) _Atomic uint64_t head;   // Rows sent
+    _Alignas(STATS_CACHE_LINE) _Atomic uint64_t tail;   // Rows received
+    unsigned char *rows;                                // HALO_SLOTS rows, in the shared mapping
+} HaloRing;
+
+// Everything the workers share, in one MAP_SHARED mapping created before the fork
+typedef struct {
+    pthread_barrier_t barrier;
+    int workers;
+    int threads;                       // OpenMP threads of every worker
+    size_t row_bytes;
+    HaloRing down[MAX_WORKERS];        // down[w]: worker w to worker w + 1
+    HaloRing up[MAX_WORKERS];          // up[w]: worker w + 1 to worker w
+    TickStats stats[2][MAX_WORKERS];   // Statistics of each worker, by tick parity
+    bool failed[MAX_WORKERS];          // Whether each worker failed to set up its strip (see run_worker)
+} Cluster;
+
+// Function to copy one row of the planes (acted included) into a halo message
+static void pack_row(const EcoSystem *ecoSystem, int i, unsigned char *out) {
+    size_t c = AT(ecoSystem, i, 0), n = (size_t) ecoSystem->cols;
+
+    memcpy(out, &ecoSystem->grid.type[c], n);
+    memcpy(out += n, &ecoSystem->grid.energy[c], n * sizeof(uint16_t));
+    memcpy(out += n * sizeof(uint16_t), &ecoSystem->grid.age[c], n);
+    memcpy(out += n, &ecoSystem->grid.starve[c], n);
+    memcpy(out + n, &ecoSystem->grid.acted[c], n * sizeof(uint16_t));
+}
+
+static void unpack_row(EcoSystem *ecoSystem, int i, const unsigned char *in) {
+    size_t c = AT(ecoSystem, i, 0), n = (size_t) ecoSystem->cols;
+
+    memcpy(&ecoSystem->grid.type[c], in, n);
+    memcpy(&ecoSystem->grid.energy[c], in += n, n * sizeof(uint16_t));
+    memcpy(&ecoSystem->grid.age[c], in += n * sizeof(uint16_t), n);
+    memcpy(&ecoSystem->grid.starve[c], in += n, n);
+    memcpy(&ecoSystem->grid.acted[c], in + n, n * sizeof(uint16_t));
+}
+
+// Function to send row i; waits only if the receiver is HALO_SLOTS rows behind
+static void halo_send(const Cluster *cluster, HaloRing *ring, const EcoSystem *ecoSystem, int i) {
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    while (head - atomic_load_explicit(&ring->tail, memory_order_acquire) == HALO_SLOTS) {
+        sched_yield();
+    }
+    pack_row(ecoSystem, i, ring->rows + (head % HALO_SLOTS) * cluster->row_bytes);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+// Function to receive the next row of a ring into row i
+static void halo_receive(const Cluster *cluster, HaloRing *ring, EcoSystem *ecoSystem, int i) {
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    while (atomic_load_explicit(&ring->head, memory_order_acquire) == tail) {
+        sched_yield();
+    }
+    unpack_row(ecoSystem, i, ring->rows + (tail % HALO_SLOTS) * cluster->row_bytes);
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+// Function to map the shared state of `workers` strip workers
+static Cluster *cluster_create(int workers, int cols) {
+    size_t row_bytes = HALO_ROW_BYTES(cols);
+    size_t links = (size_t) workers - 1;
+    size_t header = (sizeof(Cluster) + STATS_CACHE_LINE - 1) / STATS_CACHE_LINE * STATS_CACHE_LINE;
+    size_t size = header + 2 * links * HALO_SLOTS * row_bytes;
+
+    void *mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) return NULL;
+
+    Cluster *cluster = mapping;   // Zero-filled by mmap
+    cluster->workers = workers;
+    cluster->row_bytes = row_bytes;
+    unsigned char *rows = (unsigned char *) mapping + header;
+    for (size_t l = 0; l < links; l++) {
+        cluster->down[l].rows = rows + (2 * l) * HALO_SLOTS * row_bytes;
+        cluster->up[l].rows = rows + (2 * l + 1) * HALO_SLOTS * row_bytes;
+    }
+
+    pthread_barrierattr_t attributes;
+    pthread_barrierattr_init(&attributes);
+    pthread_barrierattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+    int status = pthread_barrier_init(&cluster->barrier, &attributes, (unsigned) workers);
+    pthread_barrierattr_destroy(&attributes);
+    if (status != 0) {
+        munmap(mapping, size);
+        return NULL;
+    }
+    return cluster;
+}
+
+// Function to pin the calling process to the CPUs of NUMA node (worker % nodes); returns the node, or -1
+static int pin_worker(int worker) {
+    char path[64];
+    int nodes = 0;
+
+    for (;;) {
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", nodes);
+        if (access(path, R_OK) != 0) break;
+        nodes++;
+    }
+    if (nodes == 0) return -1;
+
+    int node = worker % nodes;
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    FILE *file = fopen(path, "r");
+    char list[4096];
+    if (file == NULL) return -1;
+    bool read = fgets(list, sizeof(list), file) != NULL;
+    fclose(file);
+    if (!read) return -1;
+
+    // "0-3,8-11" style list
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (char *range = strtok(list, ",\n"); range != NULL; range = strtok(NULL, ",\n")) {
+        int low, high;
+        int fields = sscanf(range, "%d-%d", &low, &high);
+        if (fields < 1) continue;
+        if (fields == 1) high = low;
+        for (int cpu = low; cpu <= high && cpu < CPU_SETSIZE; cpu++) {
+            CPU_SET(cpu, &cpus);
+        }
+    }
+
+    return CPU_COUNT(&cpus) > 0 && sched_setaffinity(0, sizeof(cpus), &cpus) == 0 ? node : -1;
+}
+
+// Function to run one strip worker to the end of the simulation; worker 0 also logs, into `log` and
+// `stats_file` (NULL for the other workers). Before tick 0 every worker reports whether its setup worked and
+// waits for the others, so that all of them give up together instead of waiting for a strip that never comes.
+static int run_worker(const Config *config, Cluster *cluster, EcoSystem *initial, int worker, LogWriter *log,
+                      FILE *stats_file) {
+    int workers = cluster->workers;
+    int first = (int) ((long long) config->rows * worker / workers);
+    int last = (int) ((long long) config->rows * (worker + 1) / workers);
+    int has_top = worker > 0, has_bottom = worker < workers - 1;
+    int node = pin_worker(worker);
+    omp_set_num_threads(cluster->threads);
+
+    // Strip plus ghost rows, first-touched by this (pinned) process
+    Config local_config = *config;
+    local_config.rows = last - first + has_top + has_bottom;
+    local_config.engine = ENGINE_LOCKED;
+    local_config.bitboard = false;
+
+    EcoSystem local;
+    cluster->failed[worker] = create_ecosystem(&local, &local_config) != 0;
+    if (cluster->failed[worker]) {
+        fprintf(stderr, "Worker %d: error allocating its strip\n", worker);
+    }
+    pthread_barrier_wait(&cluster->barrier);
+    for (int w = 0; w < workers; w++) {
+        if (cluster->failed[w]) {
+            if (!cluster->failed[worker]) destroy_ecosystem(&local);   // create_ecosystem cleans up after itself
+            destroy_ecosystem(initial);
+            return -1;
+        }
+    }
+
+    local.row_offset = first - has_top;
+    for (int r = 0; r < local.rows; r++) {
+        size_t from = AT(initial, r + local.row_offset, 0), to = AT(&local, r, 0), n = (size_t) local.cols;
+        memcpy(&local.grid.type[to], &initial->grid.type[from], n);
+        memcpy(&local.grid.energy[to], &initial->grid.energy[from], n * sizeof(uint16_t));
+        memcpy(&local.grid.age[to], &initial->grid.age[from], n);
+        memcpy(&local.grid.starve[to], &initial->grid.starve[from], n);
+    }
+    destroy_ecosystem(initial);   // This process's copy-on-write view of the full grid
+    printf("Worker %d: rows [%d, %d), %d threads, NUMA node %d\n", worker, first, last, omp_get_max_threads(), node);
+
+    int top_ghost = 0, first_row = has_top, last_row = has_top + (last - first) - 1, bottom_ghost = last_row + 1;
+    int half = (last - first) / 2;
+    HaloRing *to_above = has_top ? &cluster->up[worker - 1] : NULL;
+    HaloRing *from_above = has_top ? &cluster->down[worker - 1] : NULL;
+    HaloRing *to_below = has_bottom ? &cluster->down[worker] : NULL;
+    HaloRing *from_below = has_bottom ? &cluster->up[worker] : NULL;
+
+    int i;
+    for (i = 0; i < config->max_ticks; i++) {
+        local.tick = i;
+        stats_begin_tick(&local.stats);
+        begin_acted(&local);
+
+        if (to_below) halo_send(cluster, to_below, &local, last_row);
+        if (from_above) halo_receive(cluster, from_above, &local, top_ghost);
+        update_rows(&local, config->reproduction, first_row, first_row + half);
+        if (to_above) halo_send(cluster, to_above, &local, top_ghost);
+        if (from_below) halo_receive(cluster, from_below, &local, last_row);
+
+        if (to_above) halo_send(cluster, to_above, &local, first_row);
+        if (from_below) halo_receive(cluster, from_below, &local, bottom_ghost);
+        update_rows(&local, config->reproduction, first_row + half, last_row + 1);
+        if (to_below) halo_send(cluster, to_below, &local, bottom_ghost);
+        if (from_above) halo_receive(cluster, from_above, &local, first_row);
+
+        // Publish this strip's statistics and add up every strip's, in worker order
+        stats_merge(&local.stats, &cluster->stats[i % 2][worker]);
+        pthread_barrier_wait(&cluster->barrier);
+        TickStats tick_stats = {0};
+        for (int w = 0; w < workers; w++) {
+            stats_add(&tick_stats, &cluster->stats[i % 2][w]);
+        }
+
+        int count_plants = (int) tick_stats.population[PLANT];
+        int count_herbivores = (int) tick_stats.population[HERBIVORE];
+        int count_carnivores = (int) tick_stats.population[CARNIVORE];
+        if (worker == 0) {
+            if (stats_file != NULL) {
+                stats_write_row(stats_file, i, &tick_stats);
+            }
+            log_writer_push(log, (TickRecord){(uint32_t) i, (uint32_t) count_plants,
+                                               (uint32_t) count_herbivores, (uint32_t) count_carnivores});
+            if (config->debug_tick > 0 && i % config->debug_tick == 0) {
+                printf("Tick %d: Plants: %d, Herbivores: %d, Carnivores: %d\n", i, count_plants, count_herbivores, count_carnivores);
+            }
+        }
+
+        if (count_herbivores == 0 || count_carnivores == 0) {
+            if (worker == 0) printf("Early stop\n");
+            break;
+        }
+    }
+
+    if (worker == 0 && config->debug_tick > 0 && i % config->debug_tick != 0) {
+        printf("Tick %d\n", i);
+    }
+    destroy_ecosystem(&local);
+    return 0;
+}
+
+// Function to run the simulation on config->workers strip worker processes
+int run_distributed(const Config *config) {
+    int workers = config->workers;
+
+    Cluster *cluster = cluster_create(workers, config->cols);
+    if (cluster == NULL) {
+        printf("Error mapping the shared memory of %d workers!\n", workers);
+        return 1;
+    }
+
+    // Workers are forked before any OpenMP thread exists, so each builds its own thread team;
+    // until then every parallel region runs on the initial thread alone
+    cluster->threads = omp_get_max_threads() / workers > 0 ? omp_get_max_threads() / workers : 1;
+    omp_set_num_threads(1);
+
+    // The initial populations are placed exactly as in a single process, then every worker copies its strip
+    Config initial_config = *config;
+    initial_config.engine = ENGINE_TILES;   // Planes only, no locks
+    initial_config.bitboard = false;
+    initial_config.pin = false;
+    EcoSystem initial;
+    if (create_ecosystem(&initial, &initial_config) != 0) {
+        printf("Error allocating a %dx%d grid!\n", config->rows, config->cols);
+        return 1;
+    }
+    init_ecosystem(&initial, config);
+
+    // Worker 0's output files are opened before the fork, so a bad path stops the run before any worker starts
+    LogWriter log;
+    if (log_writer_open(&log, config->log_path, config->log_format) != 0) {
+        printf("Error opening file!\n");
+        destroy_ecosystem(&initial);
+        return 1;
+    }
+    FILE *stats_file = NULL;
+    if (config->stats_path[0] != '\0') {
+        stats_file = fopen(config->stats_path, "w");
+        if (stats_file == NULL) {
+            printf("Error opening file '%s'!\n", config->stats_path);
+            log_writer_close(&log);
+            destroy_ecosystem(&initial);
+            return 1;
+        }
+        stats_write_header(stats_file);
+    }
+
+    fflush(stdout);
+    pid_t children[MAX_WORKERS];
+    for (int w = 1; w < workers; w++) {
+        children[w] = fork();
+        if (children[w] == 0) {
+            int status = run_worker(config, cluster, &initial, w, NULL, NULL);
+            fflush(stdout);
+            _exit(status == 0 ? 0 : 1);
+        }
+        if (children[w] < 0) {
+            // The workers already started wait on the startup barrier for this one, so stop them
+            printf("Error starting worker %d!\n", w);
+            for (int started = 1; started < w; started++) {
+                kill(children[started], SIGKILL);
+                waitpid(children[started], NULL, 0);
+            }
+            log_writer_close(&log);
+            if (stats_file != NULL) fclose(stats_file);
+            destroy_ecosystem(&initial);
+            return 1;
+        }
+    }
+
+    int status = run_worker(config, cluster, &initial, 0, &log, stats_file) == 0 ? 0 : 1;
+    for (int w = 1; w < workers; w++) {
+        int child_status;
+        if (waitpid(children[w], &child_status, 0) < 0 || !WIFEXITED(child_status) || WEXITSTATUS(child_status) != 0) {
+            status = 1;
+        }
+    }
+
+    log_writer_close(&log);
+    if (log.stalls > 0) {
+        printf("Log writer fell behind %lld times\n", log.stalls);
+    }
+    if (stats_file != NULL) {
+        fclose(stats_file);
+    }
+    return status;
+}
+
+// ---------------------------------------------------------------------------
+// Ensemble mode (--ensemble FILE or --replicas N)
+//
+// Parameter studies run many small independent worlds. Each replica is a
+// whole EcoSystem advanced from start to finish by one thread of the team, and
+// the replicas are handed out dynamically, so every core stays busy even when
+// one 80x80 grid is far too small to split. The engines' own parallel regions
+// are nested inside the replica loop and so run on a single thread. Every
+// replica builds its statistics rows in memory and appends them to the shared
+// output file when it finishes. Replicas on the batched engine of the same grid
+// size are run together in batches (see below), one job of the team per batch.
+// ---------------------------------------------------------------------------
+
+#define ENSEMBLE_LINE 1024
+
+// Settings a replica line may override
+static const char *ENSEMBLE_KEYS[] = {"size", "rows", "cols", "plants", "herbivores", "carnivores", "max_ticks",
+                                      "seed", "reproduction", "engine", "tile", "simd", "bitboard"};
+
+// Function to apply one 'key=value' replica setting
+static int ensemble_setting(Config *replica, const char *setting) {
+    const char *equals = strchr(setting, '=');
+    if (equals == NULL) return -1;
+
+    for (size_t k = 0; k < sizeof(ENSEMBLE_KEYS) / sizeof(ENSEMBLE_KEYS[0]); k++) {
+        const char *key = ENSEMBLE_KEYS[k];
+        if (strlen(key) == (size_t) (equals - setting) && strncmp(setting, key, strlen(key)) == 0) {
+            return apply_setting(replica, key, equals + 1);
+        }
+    }
+    return -1;
+}
+
+// Function to read an ensemble file: one replica per line, as whitespace-separated 'key=value' settings
+// over the base configuration ('#' starts a comment). Replicas that set no seed get the base seed plus
+// their index. Returns the number of replicas, or -1.
+static int ensemble_load(const Config *base, const char *path, Config **replicas) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Error opening ensemble file '%s'\n", path);
+        return -1;
+    }
+
+    Config *list = NULL;
+    int count = 0, capacity = 0;
+    char line[ENSEMBLE_LINE];
+    int line_number = 0;
+    int status = 0;
+
+    while (status == 0 && fgets(line, sizeof(line), file) != NULL) {
+        line_number++;
+
+        char *comment = strchr(line, '#');
+        if (comment != NULL) *comment = '\0';
+
+        char *save;
+        char *setting = strtok_r(line, " \t\r\n", &save);
+        if (setting == NULL) {
+            continue;  // Blank or comment-only line
+        }
+        if (count == capacity) {
+            capacity = capacity > 0 ? capacity * 2 : 64;
+            Config *grown = realloc(list, (size_t) capacity * sizeof(Config));
+            if (grown == NULL) {
+                status = -1;
+                break;
+            }
+            list = grown;
+        }
+
+        Config *replica = &list[count];
+        *replica = *base;
+        replica->seed = base->seed + (uint64_t) count;
+        for (; status == 0 && setting != NULL; setting = strtok_r(NULL, " \t\r\n", &save)) {
+            if (ensemble_setting(replica, setting) != 0) {
+                fprintf(stderr, "%s:%d: invalid replica setting '%s'\n", path, line_number, setting);
+                status = -1;
+            }
+        }
+        if (status == 0 && check_config(replica) != 0) {
+            fprintf(stderr, "%s:%d: invalid replica\n", path, line_number);
+            status = -1;
+        }
+        count++;
+    }
+    fclose(file);
+
+    if (status != 0 || count == 0) {
+        if (status == 0) fprintf(stderr, "'%s' lists no replicas\n", path);
+        free(list);
+        return -1;
+    }
+    *replicas = list;
+    return count;
+}
+
+// Function to run one replica to the end on the calling thread, writing its statistics rows to `out`;
+// returns the ticks it ran, or -1
+static int run_replica(const Config *config, int replica, FILE *out) {
+    EcoSystem ecoSystem;
+    if (create_ecosystem(&ecoSystem, config) != 0) {
+        return -1;
+    }
+    init_ecosystem(&ecoSystem, config);
+    int status = config->engine == ENGINE_SPARSE ? agent_lists_scan(&ecoSystem) : 0;
+    if (status == 0 && config->plant_events) {
+        status = plant_events_scan(&ecoSystem, config->reproduction);
+    }
+
+    int ticks = 0;
+    for (int i = 0; status == 0 && i < config->max_ticks; i++) {
+        ecoSystem.tick = i;
+        if (ecoSystem.bits.words > 0) {
+            bitboard_build(&ecoSystem);
+        }
+
+        stats_begin_tick(&ecoSystem.stats);
+        status = step_engine(&ecoSystem, config->engine, config->reproduction);
+        ticks++;
+
+        TickStats tick_stats;
+        stats_merge(&ecoSystem.stats, &tick_stats);
+        fprintf(out, "%d,%llu,", replica, (unsigned long long) config->seed);
+        stats_write_row(out, i, &tick_stats);
+
+        if (tick_stats.population[HERBIVORE] == 0 || tick_stats.population[CARNIVORE] == 0) {
+            break;
+        }
+    }
+
+    destroy_ecosystem(&ecoSystem);
+    return status == 0 ? ticks : -1;
+}
+
+// ---------------------------------------------------------------------------
+// Batched engine (engine=batched, ensembles only)
+//
+// An 80x80 grid is too small to keep a core's vector units busy, so batched
+// replicas of the same grid size share one set of planes with the replicas
+// interleaved: field f of cell c of replica (lane) l lives at
+// f[c * BATCH_LANES + l]. The buffered engine's plan, resolve and commit
+// phases then run once per cell for all lanes together, written with GCC
+// vector types of one 16-bit value per lane, so that each operation is a
+// single instruction on a native vector (wider vectors would have GCC split
+// the compares into scalar code). Nothing branches per lane: each lane
+// computes every outcome its cell could have and selects one with per-lane
+// masks (-1 where a compare holds, as in the SSE2/AVX2 plant kernels). The
+// neighbourhood of a cell is the same in every lane, so the grid edges stay
+// scalar tests per cell, and off-grid neighbours read a sentinel cell past
+// the end of the planes.
+//
+// Each lane has its own seed, reproduction chance and tick, and draws from
+// the same (seed, tick, cell) streams as step_buffered, so a lane is
+// bit-identical to its replica run alone on the buffered engine. When a
+// replica ends its lane is refilled with the next one of the batch, so the
+// lanes stay busy however long each world lives. A batch runs on one thread
+// of the ensemble team, like any other replica.
+// ---------------------------------------------------------------------------
+
+#define BATCH_AT(c, lane) ((size_t) (c) * BATCH_LANES + (lane))
+#define BATCH_FLUSH 32767   // Cells the 16-bit lane counters can take before they are flushed
+
+// One value per lane
+typedef int16_t Lane __attribute__((vector_size(BATCH_LANES * sizeof(int16_t))));
+typedef uint8_t LaneU8 __attribute__((vector_size(BATCH_LANES * sizeof(uint8_t))));
+typedef uint16_t LaneU16 __attribute__((vector_size(BATCH_LANES * sizeof(uint16_t))));
+typedef uint32_t LaneU32 __attribute__((vector_size(BATCH_LANES * sizeof(uint32_t))));
+typedef uint64_t LaneU64 __attribute__((vector_size(BATCH_LANES * sizeof(uint64_t))));
+
+// Lane vector helpers. They are macros rather than functions because GCC warns that passing vectors wider
+// than the target's registers by value changes the ABI.
+#define LANE_LOAD(vector_type, p) ({ vector_type lane_; memcpy(&lane_, (p), sizeof(lane_)); lane_; })
+#define LANE_BYTES(p) __builtin_convertvector(LANE_LOAD(LaneU8, p), Lane)
+#define LANE_STORE_BYTES(p, v) \
+    do { LaneU8 lane_ = __builtin_convertvector((v), LaneU8); memcpy((p), &lane_, sizeof(lane_)); } while (0)
+#define LANE_SELECT(mask, a, b) (((a) & (mask)) | ((b) & ~(mask)))
+#define LANE_PICK(direction, v0, v1, v2, v3) \
+    LANE_SELECT((direction) == 0, v0, LANE_SELECT((direction) == 1, v1, LANE_SELECT((direction) == 2, v2, v3)))
+#define LANE_INTENT(action, direction) (((action) << 2) | (direction))
+
+// Whether a mask is set in any lane, to skip the work no lane of a cell needs
+#define LANE_ANY(mask) ({ \
+    Lane any_ = (mask); \
+    uint64_t words_[sizeof(any_) / sizeof(uint64_t)], set_ = 0; \
+    memcpy(words_, &any_, sizeof(any_)); \
+    for (size_t w_ = 0; w_ < sizeof(any_) / sizeof(uint64_t); w_++) set_ |= words_[w_]; \
+    set_ != 0; })
+
+// rng_mix of every lane
+#define LANE_MIX(z) ({ \
+    LaneU64 mix_ = (z); \
+    mix_ = (mix_ ^ (mix_ >> 30)) * 0xbf58476d1ce4e5b9ULL; \
+    mix_ = (mix_ ^ (mix_ >> 27)) * 0x94d049bb133111ebULL; \
+    mix_ ^ (mix_ >> 31); })
+
+// Narrowing of 64-bit lanes, through 32 bits: GCC packs each step with a few shuffles, but converts lane by lane
+// when going straight to 16 bits
+#define LANE_NARROW(v) __builtin_convertvector(__builtin_convertvector((v), LaneU32), Lane)
+
+// Uniform integer in [0, bound) of every lane from one draw of its stream, as rng_below
+#define LANE_BELOW(draw, bound) LANE_NARROW((((draw) >> 32) * (uint64_t) (bound)) >> 32)
+
+// Counters of every lane over at most BATCH_FLUSH cells, then added to the lanes' TickStats
+typedef struct {
+    Lane population[SPECIES];
+    LaneU32 energy[SPECIES];
+    Lane births[SPECIES];
+    Lane deaths[SPECIES][DEATH_CAUSES];
+    Lane moves[SPECIES];
+} LaneCounts;
+
+typedef struct {
+    int rows;
+    int cols;
+    Planes grid;         // (rows * cols + 1) * BATCH_LANES entries per plane, the last cell is the off-grid sentinel
+    Planes back;         // Planes the next tick is written into
+    uint8_t *intent;     // Planned action of every cell and lane
+    uint8_t *claim;      // Direction of the neighbour that takes every cell and lane
+    uint64_t seed[BATCH_LANES];
+    uint64_t tick[BATCH_LANES];
+    Lane reproduction;
+    LaneU64 tick_key;    // Stream key of every lane for its current tick, before mixing in the cell
+    uint64_t death_by_age[3][AGE_LIMIT];
+    LaneCounts counts;
+    TickStats stats[BATCH_LANES];
+} Batch;
+
+// Function to release the planes of a batch
+void batch_destroy(Batch *batch) {
+    Planes *planes[2] = {&batch->grid, &batch->back};
+    for (int p = 0; p < 2; p++) {
+        free(planes[p]->type);
+        free(planes[p]->energy);
+        free(planes[p]->age);
+        free(planes[p]->starve);
+    }
+    free(batch->intent);
+    free(batch->claim);
+    free(batch);
+}
+
+// Function to allocate a batch of rows x cols grids with every lane empty
+Batch *batch_create(int rows, int cols) {
+    Batch *batch = aligned_calloc(1, sizeof(Batch));
+    if (batch == NULL) {
+        return NULL;
+    }
+    batch->rows = rows;
+    batch->cols = cols;
+
+    size_t cells = (size_t) rows * cols;
+    size_t entries = (cells + 1) * BATCH_LANES;
+    bool ok = true;
+    Planes *planes[2] = {&batch->grid, &batch->back};
+    for (int p = 0; p < 2; p++) {
+        planes[p]->type = aligned_calloc(entries, sizeof(uint8_t));
+        planes[p]->energy = aligned_calloc(entries, sizeof(uint16_t));
+        planes[p]->age = aligned_calloc(entries, sizeof(uint8_t));
+        planes[p]->starve = aligned_calloc(entries, sizeof(uint8_t));
+        ok = ok && planes[p]->type != NULL && planes[p]->energy != NULL && planes[p]->age != NULL
+             && planes[p]->starve != NULL;
+    }
+    batch->intent = aligned_calloc(entries, sizeof(uint8_t));
+    batch->claim = aligned_calloc(entries, sizeof(uint8_t));
+    if (!ok || batch->intent == NULL || batch->claim == NULL) {
+        batch_destroy(batch);
+        return NULL;
+    }
+
+    // The sentinel is neither plant nor empty, and nobody's claimant
+    memset(batch->grid.type, EMPTY, entries);
+    for (int p = 0; p < 2; p++) {
+        memset(&planes[p]->type[BATCH_AT(cells, 0)], OFF_GRID, BATCH_LANES);
+    }
+    memset(&batch->claim[BATCH_AT(cells, 0)], NO_CLAIM, BATCH_LANES);
+    return batch;
+}
+
+// Function to start a replica in a lane, built exactly as run_replica builds it
+int batch_load(Batch *batch, int lane, const Config *replica) {
+    size_t cells = (size_t) batch->rows * batch->cols;
+    Config config = *replica;
+    config.engine = ENGINE_TILES;   // Planes only
+    config.bitboard = false;
+    config.dirty_tiles = false;
+    EcoSystem ecoSystem;
+    if (create_ecosystem(&ecoSystem, &config) != 0) {
+        return -1;
+    }
+    init_ecosystem(&ecoSystem, &config);
+    for (size_t c = 0; c < cells; c++) {
+        size_t at = BATCH_AT(c, lane);
+        ptrdiff_t from = AT(&ecoSystem, c / (size_t) batch->cols, c % (size_t) batch->cols);
+        batch->grid.type[at] = ecoSystem.grid.type[from];
+        batch->grid.energy[at] = ecoSystem.grid.energy[from];
+        batch->grid.age[at] = ecoSystem.grid.age[from];
+        batch->grid.starve[at] = ecoSystem.grid.starve[from];
+    }
+    memcpy(batch->death_by_age, ecoSystem.death_by_age, sizeof(batch->death_by_age));
+    destroy_ecosystem(&ecoSystem);
+
+    batch->seed[lane] = config.seed;
+    batch->tick[lane] = 0;
+    batch->reproduction[lane] = (int16_t) config.reproduction;
+    return 0;
+}
+
+// Function to add the lane counters into the lanes' statistics and clear them
+static void batch_flush(Batch *batch) {
+    LaneCounts *counts = &batch->counts;
+    for (int l = 0; l < BATCH_LANES; l++) {
+        TickStats *stats = &batch->stats[l];
+        for (int s = 0; s < SPECIES; s++) {
+            stats->population[s] += counts->population[s][l];
+            stats->energy[s] += counts->energy[s][l];
+            stats->births[s] += counts->births[s][l];
+            stats->moves[s] += counts->moves[s][l];
+            for (int d = 0; d < DEATH_CAUSES; d++) {
+                stats->deaths[s][d] += counts->deaths[s][d][l];
+            }
+        }
+    }
+    memset(counts, 0, sizeof(*counts));
+}
+
+// Function to get the four neighbours of cell (i, j) in direction order, the sentinel for the off-grid ones
+static inline void batch_neighbours(const Batch *batch, int i, int j, size_t near[4]) {
+    size_t c = (size_t) i * batch->cols + j;
+    size_t sentinel = (size_t) batch->rows * batch->cols;
+    near[0] = i + 1 < batch->rows ? c + batch->cols : sentinel;
+    near[1] = i > 0 ? c - batch->cols : sentinel;
+    near[2] = j + 1 < batch->cols ? c + 1 : sentinel;
+    near[3] = j > 0 ? c - 1 : sentinel;
+}
+
+// Function to plan the actions of cell (i, j) in every lane, as plan_plant and plan_animal do
+static void batch_plan_cell(Batch *batch, int i, int j) {
+    size_t c = (size_t) i * batch->cols + j;
+    size_t near[4];
+    batch_neighbours(batch, i, j, near);
+
+    const uint8_t *type = batch->grid.type;
+    Lane t = LANE_BYTES(&type[BATCH_AT(c, 0)]);
+    if (!LANE_ANY(t != EMPTY)) {
+        memset(&batch->intent[BATCH_AT(c, 0)], INTENT(ACTION_STAY, 0), BATCH_LANES);
+        return;
+    }
+    LaneU16 e = LANE_LOAD(LaneU16, &batch->grid.energy[BATCH_AT(c, 0)]);
+    Lane age = LANE_BYTES(&batch->grid.age[BATCH_AT(c, 0)]);
+    Lane starve = LANE_BYTES(&batch->grid.starve[BATCH_AT(c, 0)]);
+    Lane n0 = LANE_BYTES(&type[BATCH_AT(near[0], 0)]);
+    Lane n1 = LANE_BYTES(&type[BATCH_AT(near[1], 0)]);
+    Lane n2 = LANE_BYTES(&type[BATCH_AT(near[2], 0)]);
+    Lane n3 = LANE_BYTES(&type[BATCH_AT(near[3], 0)]);
+
+    LaneU64 key = LANE_MIX(batch->tick_key ^ ((uint64_t) c + RNG_GAMMA));
+    LaneU64 first = LANE_MIX(key + RNG_GAMMA);
+    LaneU64 second = LANE_MIX(key + 2 * RNG_GAMMA);
+
+    // Plants: death by overpopulation, else a random direction and the reproduction roll
+    Lane plants = -(n0 == PLANT) - (n1 == PLANT) - (n2 == PLANT) - (n3 == PLANT);
+    Lane plant_direction = LANE_BELOW(first, 4);
+    Lane plant_spawns = (LANE_PICK(plant_direction, n0, n1, n2, n3) == EMPTY)
+                        & (LANE_BELOW(second, 100) < batch->reproduction);
+    Lane plant = LANE_SELECT(plants > 3, LANE_INTENT(ACTION_DIE, 0),
+                             LANE_SELECT(plant_spawns, LANE_INTENT(ACTION_SPAWN, plant_direction),
+                                         LANE_INTENT(ACTION_STAY, 0)));
+
+    // Animals: starvation and age, then a random direction, with the rules of each lane's species
+    Lane carnivore = t == CARNIVORE;
+    Lane starvation = LANE_SELECT(carnivore, (int16_t) SPECIES_RULES[CARNIVORE].starvation,
+                                  (int16_t) SPECIES_RULES[HERBIVORE].starvation);
+    Lane spawn_energy = LANE_SELECT(carnivore, (int16_t) SPECIES_RULES[CARNIVORE].spawn_energy,
+                                    (int16_t) SPECIES_RULES[HERBIVORE].spawn_energy);
+    Lane prey = LANE_SELECT(carnivore, HERBIVORE, PLANT);
+    Lane aged = {0};
+    if (LANE_ANY((t == HERBIVORE) | carnivore)) {
+        // Death-by-age threshold of every lane, a table lookup per lane (a gather where the target has one)
+        Lane row = LANE_SELECT(carnivore, CARNIVORE * AGE_LIMIT, HERBIVORE * AGE_LIMIT) + age + 1;
+        LaneU32 slot = __builtin_convertvector(row, LaneU32);
+        const uint64_t *table = &batch->death_by_age[0][0];
+        uint64_t thresholds[BATCH_LANES];
+        for (int l = 0; l < BATCH_LANES; l++) {
+            thresholds[l] = table[slot[l]];
+        }
+        LaneU64 old = LANE_LOAD(LaneU64, thresholds);
+        // The draw is below the threshold iff the 64-bit difference wraps
+        aged = -LANE_NARROW(((first >> 32) - old) >> 63);
+    }
+    Lane dies = (starve > starvation) | aged;
+    Lane direction = LANE_BELOW(second, 4);
+    Lane target = LANE_PICK(direction, n0, n1, n2, n3);
+    Lane away = LANE_PICK(direction ^ 1, n0, n1, n2, n3);
+    Lane roams = LANE_SELECT(e > (LaneU16) spawn_energy, ACTION_SPAWN, ACTION_MOVE);
+    Lane facing = (t == HERBIVORE) & (target == CARNIVORE);
+    Lane flees = {0};
+    if (LANE_ANY(facing)) {   // Only a herbivore facing a carnivore draws a third time
+        LaneU64 third = LANE_MIX(key + 3 * RNG_GAMMA);
+        flees = LANE_SELECT(LANE_BELOW(third, 100) < (int16_t) SPECIES_RULES[HERBIVORE].freeze_chance,
+                            LANE_INTENT(ACTION_STAY, 0) | INTENT_HUNGRY,
+                            LANE_SELECT(away == EMPTY, LANE_INTENT(ACTION_MOVE, direction ^ 1),
+                                        LANE_INTENT(ACTION_STAY, 0)));
+    }
+    Lane animal = LANE_SELECT(dies, LANE_INTENT(ACTION_DIE, 0),
+                  LANE_SELECT(target == prey, LANE_INTENT(ACTION_EAT, direction),
+                  LANE_SELECT(target == EMPTY, LANE_INTENT(roams, direction) | INTENT_HUNGRY,
+                  LANE_SELECT(facing, flees, LANE_INTENT(ACTION_STAY, 0)))));
+
+    Lane intent = LANE_SELECT(t == PLANT, plant, LANE_SELECT(t == EMPTY, LANE_INTENT(ACTION_STAY, 0), animal));
+    LANE_STORE_BYTES(&batch->intent[BATCH_AT(c, 0)], intent);
+
+    LaneCounts *counts = &batch->counts;
+    for (int s = PLANT; s <= CARNIVORE; s++) {
+        Lane is = t == (int16_t) s;
+        counts->population[s] -= is;
+        counts->energy[s] += __builtin_convertvector(e & (LaneU16) is, LaneU32);
+    }
+}
+
+// Function to resolve the claims on cell (i, j) in every lane, as resolve_claim does. The predation pass
+// resolves the herbivores' cells, the other one the empty and plant cells.
+static void batch_resolve_cell(Batch *batch, int i, int j, bool predation) {
+    size_t c = (size_t) i * batch->cols + j;
+    size_t near[4];
+    batch_neighbours(batch, i, j, near);
+
+    Lane target = LANE_BYTES(&batch->grid.type[BATCH_AT(c, 0)]);
+    Lane contested = predation ? target == HERBIVORE : (target == EMPTY) | (target == PLANT);
+    if (!LANE_ANY(contested)) {
+        if (predation) memset(&batch->claim[BATCH_AT(c, 0)], NO_CLAIM, BATCH_LANES);
+        return;
+    }
+    Lane current = LANE_BYTES(&batch->claim[BATCH_AT(c, 0)]);
+
+    // Rank the claim of every neighbour as claim_rank does, 0 when it has none
+    Lane rank[4];
+    Lane best = {0};
+    for (int from = 0; from < 4; from++) {   // Direction from (i, j) to the claimant
+        Lane claimant = LANE_BYTES(&batch->grid.type[BATCH_AT(near[from], 0)]);
+        Lane intent = LANE_BYTES(&batch->intent[BATCH_AT(near[from], 0)]);
+        Lane claim = LANE_BYTES(&batch->claim[BATCH_AT(near[from], 0)]);
+        Lane action = (intent >> 2) & 7;
+        Lane heading = (intent & 3) == (int16_t) (from ^ 1);
+        Lane eats = action == ACTION_EAT;
+
+        // A herbivore that is being eaten this tick cannot claim anything else
+        Lane blocked = (claimant == HERBIVORE) & (target != HERBIVORE) & (claim != NO_CLAIM);
+        Lane settles = LANE_SELECT(action == ACTION_MOVE, 2 * claimant + 2,
+                                   LANE_SELECT(action == ACTION_SPAWN, 2 * claimant + 1, 0));
+        Lane value = LANE_SELECT(target == HERBIVORE, (claimant == CARNIVORE) & eats & 1,
+                     LANE_SELECT(target == PLANT, (claimant == HERBIVORE) & eats & 1,
+                     LANE_SELECT(target == EMPTY, settles, 0)));
+        rank[from] = value & heading & ~blocked;
+        best = LANE_SELECT(rank[from] > best, rank[from], best);
+    }
+    Lane ties = -(rank[0] == best) - (rank[1] == best) - (rank[2] == best) - (rank[3] == best);
+
+    // Break ties clockwise from a random start direction: the tied claimant fewest steps after it wins
+    Lane tied = (ties > 1) & (best > 0);
+    Lane start = {0};
+    if (LANE_ANY(tied)) {
+        LaneU64 key = LANE_MIX(batch->tick_key ^ ((uint64_t) batch->rows * batch->cols + c + RNG_GAMMA));
+        start = LANE_SELECT(tied, LANE_BELOW(LANE_MIX(key + RNG_GAMMA), 4), 0);
+    }
+    Lane winner = {0}, distance = winner + 4;
+    for (int from = 0; from < 4; from++) {
+        Lane steps = ((int16_t) from - start) & 3;
+        Lane wins = (rank[from] == best) & (steps < distance);
+        winner = LANE_SELECT(wins, (int16_t) from, winner);
+        distance = LANE_SELECT(wins, steps, distance);
+    }
+    Lane resolved = LANE_SELECT(best > 0, winner ^ 1, NO_CLAIM);   // Stored as the claimant's direction
+
+    Lane claim = predation ? LANE_SELECT(contested, resolved, NO_CLAIM) : LANE_SELECT(contested, resolved, current);
+    LANE_STORE_BYTES(&batch->claim[BATCH_AT(c, 0)], claim);
+}
+
+// Function to compute the next state of cell (i, j) in every lane into the back planes, as commit_cell does
+static void batch_commit_cell(Batch *batch, int i, int j) {
+    size_t c = (size_t) i * batch->cols + j;
+    size_t near[4];
+    batch_neighbours(batch, i, j, near);
+
+    const Planes *grid = &batch->grid;
+    size_t at = BATCH_AT(c, 0);
+    size_t at0 = BATCH_AT(near[0], 0), at1 = BATCH_AT(near[1], 0);
+    size_t at2 = BATCH_AT(near[2], 0), at3 = BATCH_AT(near[3], 0);
+
+#define LANE_NEAR(direction, plane) \
+    LANE_PICK(direction, LANE_BYTES(&(plane)[at0]), LANE_BYTES(&(plane)[at1]), \
+              LANE_BYTES(&(plane)[at2]), LANE_BYTES(&(plane)[at3]))
+#define LANE_NEAR_ENERGY(direction) \
+    LANE_PICK((LaneU16) (direction), LANE_LOAD(LaneU16, &grid->energy[at0]), LANE_LOAD(LaneU16, &grid->energy[at1]), \
+              LANE_LOAD(LaneU16, &grid->energy[at2]), LANE_LOAD(LaneU16, &grid->energy[at3]))
+
+    Lane t = LANE_BYTES(&grid->type[at]);
+    LaneU16 e = LANE_LOAD(LaneU16, &grid->energy[at]);
+    Lane a = LANE_BYTES(&grid->age[at]), s = LANE_BYTES(&grid->starve[at]);
+    Lane intent = LANE_BYTES(&batch->intent[at]), claim = LANE_BYTES(&batch->claim[at]);
+    Lane action = (intent >> 2) & 7;
+    Lane hungry = (intent & INTENT_HUNGRY) != 0;
+    Lane carnivore = t == CARNIVORE;
+    Lane animal = (t == HERBIVORE) | carnivore;
+
+    // The agent stays (or was blocked), leaves, or dies in its cell. Spawning takes more energy than it
+    // costs, so the energy cannot wrap below 0.
+    Lane direction = intent & 3;
+    Lane moving = action >= ACTION_MOVE;
+    Lane won = moving & (LANE_NEAR(direction, batch->claim) == direction);
+    Lane vacates = (action == ACTION_DIE) | (won & (action != ACTION_SPAWN));
+    Lane spawn_cost = LANE_SELECT(carnivore, (int16_t) SPECIES_RULES[CARNIVORE].spawn_cost,
+                                  LANE_SELECT(t == HERBIVORE, (int16_t) SPECIES_RULES[HERBIVORE].spawn_cost, 0));
+    LaneU16 own_energy = e - (LaneU16) (won & (action == ACTION_SPAWN) & spawn_cost);
+    Lane own_age = a - animal;
+    Lane own_starve = s - (animal & hungry) - (animal & moving & ~won & ~hungry);
+
+    // A neighbour won this cell: a predator adds the prey's energy to its own (saturating, as store_cell
+    // clamps it), a mover keeps its state and a newborn starts afresh
+    Lane claimed = claim != NO_CLAIM;
+    Lane from = (claim ^ 1) & 3;
+    Lane wt = LANE_NEAR(from, grid->type), wa = LANE_NEAR(from, grid->age), ws = LANE_NEAR(from, grid->starve);
+    LaneU16 we = LANE_NEAR_ENERGY(from);
+    Lane wi = LANE_NEAR(from, batch->intent);
+    Lane waction = (wi >> 2) & 7;
+    Lane w_animal = wt != PLANT;
+    Lane newborn = LANE_SELECT(wt == CARNIVORE, (int16_t) SPECIES_RULES[CARNIVORE].newborn_energy,
+                               LANE_SELECT(wt == HERBIVORE, (int16_t) SPECIES_RULES[HERBIVORE].newborn_energy,
+                                           (int16_t) SPECIES_RULES[PLANT].newborn_energy));
+    LaneU16 meal = we + e;
+    meal |= (LaneU16) (meal < we);
+    LaneU16 taken_energy = LANE_SELECT((LaneU16) (waction == ACTION_EAT), meal,
+                                       LANE_SELECT((LaneU16) (waction == ACTION_MOVE), we, (LaneU16) newborn));
+    Lane taken_age = LANE_SELECT(waction == ACTION_SPAWN, 0, wa - w_animal);
+    Lane taken_starve = LANE_SELECT(waction == ACTION_MOVE, ws - (w_animal & ((wi & INTENT_HUNGRY) != 0)), 0);
+
+#undef LANE_NEAR_ENERGY
+#undef LANE_NEAR
+
+    Lane next_type = LANE_SELECT(claimed, wt, LANE_SELECT(vacates, EMPTY, t));
+    LaneU16 next_energy = LANE_SELECT((LaneU16) claimed, taken_energy, own_energy & ~(LaneU16) vacates);
+    Lane next_age = LANE_SELECT(claimed, taken_age, LANE_SELECT(vacates, 0, own_age));
+    Lane next_starve = LANE_SELECT(claimed, taken_starve, LANE_SELECT(vacates, 0, own_starve));
+
+    // Clamp the ages and starvation counters to their planes, as store_cell does
+    next_age = LANE_SELECT(next_age > UINT8_MAX, UINT8_MAX, next_age);
+    next_starve = LANE_SELECT(next_starve > UINT8_MAX, UINT8_MAX, next_starve);
+    LANE_STORE_BYTES(&batch->back.type[at], next_type);
+    memcpy(&batch->back.energy[at], &next_energy, sizeof(next_energy));
+    LANE_STORE_BYTES(&batch->back.age[at], next_age);
+    LANE_STORE_BYTES(&batch->back.starve[at], next_starve);
+
+    // Births, moves and deaths of every lane (the masks are -1 where true)
+    LaneCounts *counts = &batch->counts;
+    Lane born = claimed & (waction == ACTION_SPAWN);
+    Lane moved = claimed & (waction != ACTION_SPAWN);
+    Lane eaten = claimed & (waction == ACTION_EAT);
+    Lane died = ~claimed & (action == ACTION_DIE);
+    Lane starved = s > LANE_SELECT(carnivore, (int16_t) SPECIES_RULES[CARNIVORE].starvation,
+                                   (int16_t) SPECIES_RULES[HERBIVORE].starvation);
+    for (int species = PLANT; species <= CARNIVORE; species++) {
+        counts->births[species] -= born & (wt == (int16_t) species);
+        counts->moves[species] -= moved & (wt == (int16_t) species);
+        counts->deaths[species][DEATH_PREDATION] -= eaten & (t == (int16_t) species);
+    }
+    counts->deaths[PLANT][DEATH_OVERPOPULATION] -= died & (t == PLANT);
+    counts->deaths[HERBIVORE][DEATH_STARVATION] -= died & (t == HERBIVORE) & starved;
+    counts->deaths[HERBIVORE][DEATH_AGE] -= died & (t == HERBIVORE) & ~starved;
+    counts->deaths[CARNIVORE][DEATH_STARVATION] -= died & carnivore & starved;
+    counts->deaths[CARNIVORE][DEATH_AGE] -= died & carnivore & ~starved;
+}
+
+// Function to advance every lane of a batch by one tick, on the calling thread, leaving the statistics of the
+// tick of every lane in batch->stats
+void step_batch(Batch *batch) {
+    int rows = batch->rows, cols = batch->cols;
+
+    memset(batch->stats, 0, sizeof(batch->stats));
+    for (int l = 0; l < BATCH_LANES; l++) {
+        uint64_t key = rng_mix(batch->seed[l] + RNG_GAMMA);
+        batch->tick_key[l] = rng_mix(key ^ (batch->tick[l] + RNG_GAMMA));
+    }
+
+    // 1. Plan
+    int pending = 0;   // Cells counted since the last flush
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            batch_plan_cell(batch, i, j);
+            if (++pending == BATCH_FLUSH) {
+                batch_flush(batch);
+                pending = 0;
+            }
+        }
+    }
+    batch_flush(batch);
+
+    // 2a. Resolve predation, 2b. moves, meals of plants and spawns
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < rows; i++) {
+            for (int j = 0; j < cols; j++) {
+                batch_resolve_cell(batch, i, j, pass == 0);
+            }
+        }
+    }
+
+    // 3. Commit into the back planes, which become the front planes of the next tick
+    pending = 0;
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            batch_commit_cell(batch, i, j);
+            if (++pending == BATCH_FLUSH) {
+                batch_flush(batch);
+                pending = 0;
+            }
+        }
+    }
+    batch_flush(batch);
+    Planes front = batch->grid;
+    batch->grid = batch->back;
+    batch->back = front;
+}
+
+// Function to run the replicas `members` (all batched, of one grid size) on the calling thread, BATCH_LANES at a
+// time, appending the statistics rows of each replica to `out` when it ends, as run_ensemble does for the others;
+// returns the total ticks the replicas ran, and adds those that could not run to *failures
+static long long run_batch(const Config *replicas, const int *members, int count, FILE *out, int *failures) {
+    Batch *batch = batch_create(replicas[members[0]].rows, replicas[members[0]].cols);
+    if (batch == NULL) {
+        *failures += count;
+        return 0;
+    }
+
+    int member[BATCH_LANES];   // Replica (index into members) in every lane, -1 while the lane is idle
+    char *rows[BATCH_LANES];
+    size_t sizes[BATCH_LANES];
+    FILE *buffers[BATCH_LANES];
+    for (int lane = 0; lane < BATCH_LANES; lane++) {
+        member[lane] = -1;
+    }
+
+    long long ticks = 0;
+    int next = 0, active = 0;
+    for (;;) {
+        // Idle lanes take the next replicas; the lanes of finished ones keep running unseen until then
+        for (int lane = 0; lane < BATCH_LANES && next < count; lane++) {
+            while (member[lane] < 0 && next < count) {
+                const Config *config = &replicas[members[next]];
+                int k = next++;
+                if (config->max_ticks <= 0) continue;
+                buffers[lane] = open_memstream(&rows[lane], &sizes[lane]);
+                if (buffers[lane] == NULL || batch_load(batch, lane, config) != 0) {
+                    if (buffers[lane] != NULL) {
+                        fclose(buffers[lane]);
+                        free(rows[lane]);
+                    }
+                    (*failures)++;
+                    continue;
+                }
+                member[lane] = k;
+                active++;
+            }
+        }
+        if (active == 0) break;
+
+        step_batch(batch);
+
+        for (int lane = 0; lane < BATCH_LANES; lane++) {
+            if (member[lane] < 0) continue;
+            const Config *config = &replicas[members[member[lane]]];
+            const TickStats *tick_stats = &batch->stats[lane];
+            fprintf(buffers[lane], "%d,%llu,", members[member[lane]], (unsigned long long) config->seed);
+            stats_write_row(buffers[lane], (long long) batch->tick[lane], tick_stats);
+            ticks++;
+
+            if (++batch->tick[lane] >= (uint64_t) config->max_ticks || tick_stats->population[HERBIVORE] == 0
+                || tick_stats->population[CARNIVORE] == 0) {
+                fclose(buffers[lane]);
+                #pragma omp critical(ensemble_out)
+                fwrite(rows[lane], 1, sizes[lane], out);
+                free(rows[lane]);
+                member[lane] = -1;
+                active--;
+            }
+        }
+    }
+
+    batch_destroy(batch);
+    return ticks;
+}
+
+// Function to run every replica of an ensemble on the OpenMP team
+int run_ensemble(const Config *config) {
+    Config *replicas = NULL;
+    int count = config->replicas;
+
+    if (config->ensemble_path[0] != '\0') {
+        count = ensemble_load(config, config->ensemble_path, &replicas);
+        if (count < 0) {
+            return 1;
+        }
+    } else {
+        replicas = malloc((size_t) count * sizeof(Config));
+        if (replicas == NULL) {
+            return 1;
+        }
+        for (int r = 0; r < count; r++) {
+            replicas[r] = *config;
+            replicas[r].seed = config->seed + (uint64_t) r;
+        }
+    }
+
+    // A replica has its thread to itself, so the locks of the locked engine would only cost time
+    for (int r = 0; r < count; r++) {
+        if (replicas[r].engine == ENGINE_LOCKED) replicas[r].engine = ENGINE_TILES;
+    }
+
+    FILE *out = fopen(config->ensemble_out, "w");
+    if (out == NULL) {
+        printf("Error opening file '%s'!\n", config->ensemble_out);
+        free(replicas);
+        return 1;
+    }
+    fprintf(out, "replica,seed,");
+    stats_write_header(out);
+
+    // Every replica is a job of its own, except the batched ones: those of the same grid size are split into
+    // as many jobs as there are threads to run them, each a batch of at least BATCH_LANES replicas unless the
+    // group is smaller. Job k runs the replicas order[first[k]] to order[first[k + 1] - 1].
+    int *order = malloc((size_t) count * sizeof(int));
+    int *first = malloc(((size_t) count + 1) * sizeof(int));
+    bool *placed = calloc((size_t) count, sizeof(bool));
+    if (order == NULL || first == NULL || placed == NULL) {
+        free(order);
+        free(first);
+        free(placed);
+        fclose(out);
+        free(replicas);
+        return 1;
+    }
+    int jobs = 0, placed_count = 0;
+    for (int r = 0; r < count; r++) {
+        if (placed[r]) continue;
+        int group = placed_count;
+        for (int m = r; m < count; m++) {
+            bool joins = m == r || (replicas[r].engine == ENGINE_BATCHED && replicas[m].engine == ENGINE_BATCHED
+                                    && !placed[m] && replicas[m].rows == replicas[r].rows
+                                    && replicas[m].cols == replicas[r].cols);
+            if (!joins) continue;
+            placed[m] = true;
+            order[placed_count++] = m;
+            if (replicas[r].engine != ENGINE_BATCHED) break;
+        }
+        int size = placed_count - group;
+        int split = (size + BATCH_LANES - 1) / BATCH_LANES;
+        if (split > omp_get_max_threads()) split = omp_get_max_threads();
+        for (int k = 0; k < split; k++) {
+            first[jobs++] = group + (int) ((long long) size * k / split);
+        }
+    }
+    first[jobs] = placed_count;
+    free(placed);
+
+    omp_set_max_active_levels(1);   // The engines' regions inside a replica run on its thread alone
+    long long total_ticks = 0;
+    int failures = 0;
+    double start = omp_get_wtime();
+
+    #pragma omp parallel for schedule(dynamic, 1) reduction(+ : total_ticks, failures)
+    for (int job = 0; job < jobs; job++) {
+        const int *members = &order[first[job]];
+        int r = members[0];
+        if (replicas[r].engine == ENGINE_BATCHED) {
+            total_ticks += run_batch(replicas, members, first[job + 1] - first[job], out, &failures);
+            continue;
+        }
+
+        char *rows = NULL;
+        size_t size = 0;
+        FILE *buffer = open_memstream(&rows, &size);
+        int ticks = buffer != NULL ? run_replica(&replicas[r], r, buffer) : -1;
+        if (buffer != NULL) fclose(buffer);
+
+        if (ticks < 0) {
+            failures++;
+        } else {
+            total_ticks += ticks;
+            #pragma omp critical(ensemble_out)
+            fwrite(rows, 1, size, out);
+        }
+        free(rows);
+    }
+
+    double elapsed = omp_get_wtime() - start;
+    fclose(out);
+    printf("%d replicas, %lld ticks in %.3f s (%.0f ticks/s) on %d threads, statistics in '%s'\n",
+           count - failures, total_ticks, elapsed, total_ticks / elapsed, omp_get_max_threads(),
+           config->ensemble_out);
+    if (failures > 0) {
+        printf("%d replicas ran out of memory\n", failures);
+    }
+    free(order);
+    free(first);
+    free(replicas);
+    return failures > 0 ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    Config config;
+    if (parse_config(&config, argc, argv) != 0) {
+        exit(1);
+    }
+    if (config.workers > 1) {
+        return run_distributed(&config);
+    }
+    if (config.ensemble_path[0] != '\0' || config.replicas > 0) {
+        return run_ensemble(&config);
+    }
+
+    // A resumed run takes its grid size, seed and first tick from the checkpoint
+    uint64_t first_tick = 0;
+    bool resume = config.resume_path[0] != '\0';
+    if (resume && checkpoint_read_header(config.resume_path, &config, &first_tick) != 0) {
+        exit(1);
+    }
+
+    // open the tick log ('iter.log' by default), written by a background thread
+    LogWriter log;
+
+    if (log_writer_open(&log, config.log_path, config.log_format) != 0) {
+        printf("Error opening file!\n");
+        exit(1);
+    }
+
+
+    // Optional per-tick statistics (CSV)
+    FILE *stats_file = NULL;
+    if (config.stats_path[0] != '\0') {
+        stats_file = fopen(config.stats_path, "w");
+        if (stats_file == NULL) {
+            printf("Error opening file '%s'!\n", config.stats_path);
+            exit(1);
+        }
+        stats_write_header(stats_file);
+    }
+
+    // Optional per-tick state hashes, written or compared against a reference run
+    FILE *hash_file = NULL;
+    FILE *hash_reference = NULL;
+    if (config.hash_path[0] != '\0' && (hash_file = fopen(config.hash_path, "w")) == NULL) {
+        printf("Error opening file '%s'!\n", config.hash_path);
+        exit(1);
+    }
+    if (config.hash_check_path[0] != '\0' && (hash_reference = fopen(config.hash_check_path, "r")) == NULL) {
+        printf("Error opening file '%s'!\n", config.hash_check_path);
+        exit(1);
+    }
+    int diverged = 0;
+
+    // Initialize the ecosystem
+    EcoSystem ecoSystem;
+    bool plants_restored = false;   // The checkpoint held the plant event state
+    if (create_ecosystem(&ecoSystem, &config) != 0) {
+        printf("Error allocating a %dx%d grid!\n", config.rows, config.cols);
+        exit(1);
+    }
+    if (!resume) {
+        init_ecosystem(&ecoSystem, &config);
+    } else if (checkpoint_load(&ecoSystem, config.resume_path, &plants_restored) != 0) {
+        exit(1);
+    } else {
+        printf("Resuming from tick %llu\n", (unsigned long long) first_tick);
+    }
+    if (config.engine == ENGINE_SPARSE
+        && (agent_lists_scan(&ecoSystem) != 0
+            || (config.plant_events && (plants_restored ? plant_events_restore(&ecoSystem)
+                                        : plant_events_scan(&ecoSystem, config.reproduction)) != 0))) {
+        printf("Error allocating the agent lists!\n");
+        exit(1);
+    }
+    if (config.trace_path[0] != '\0'
+        && trace_open(&ecoSystem.trace, config.trace_path, config.trace_format, omp_get_max_threads()) != 0) {
+        printf("Error opening file '%s'!\n", config.trace_path);
+        exit(1);
+    }
+
+    // Optional binary snapshots, replacing the printed grid dumps
+    SnapshotWriter snapshots;
+    bool snapshot = config.snapshot_path[0] != '\0';
+    if (snapshot && snapshot_writer_open(&snapshots, config.snapshot_path, config.rows, config.cols,
+                                         config.snapshot_encoding) != 0) {
+        printf("Error opening file '%s'!\n", config.snapshot_path);
+        exit(1);
+    }
+    if (config.engine == ENGINE_BUFFERED) {
+        printf("Plant row kernel: %s\n", ecoSystem.plant_kernel_name);
+    }
+    if (config.pin) {
+        report_placement(&ecoSystem);
+    }
+    omp_set_dynamic(!config.pin);   // Pinned runs keep full teams, so every thread keeps the tiles it touched first
+
+    bool checkpoint = config.checkpoint_path[0] != '\0';
+    pid_t checkpoint_child = 0;
+    int checkpoint_failures = 0;
+
+    double start = omp_get_wtime();
+    int ticks_run = 0;
+
+    int i;
+    for(i = (int) first_tick; i < config.max_ticks; i++) {
+        ecoSystem.tick = i;
+
+        // Species bit planes of the state at the start of the tick
+        int species[3] = {0, 0, 0};
+        if (ecoSystem.bits.words > 0) {
+            bitboard_build(&ecoSystem);
+            bitboard_count(&ecoSystem, species);
+        }
+
+        stats_begin_tick(&ecoSystem.stats);
+
+        if (step_engine(&ecoSystem, config.engine, config.reproduction) != 0) {
+            printf("Error growing the agent lists!\n");
+            exit(1);
+        }
+        ticks_run++;
+
+        // Merge the per-thread statistics once per tick
+        trace_begin(&ecoSystem.trace, PHASE_LOG);
+        TickStats tick_stats;
+        stats_merge(&ecoSystem.stats, &tick_stats);
+        if (stats_file != NULL) {
+            stats_write_row(stats_file, i, &tick_stats);
+        }
+
+        int count_plants = (int) tick_stats.population[PLANT];
+        int count_herbivores = (int) tick_stats.population[HERBIVORE];
+        int count_carnivores = (int) tick_stats.population[CARNIVORE];
+        if (ecoSystem.bits.words > 0) {
+            count_plants = species[PLANT];
+            count_herbivores = species[HERBIVORE];
+            count_carnivores = species[CARNIVORE];
+        }
+
+        // Queue the ecosystem state for the log writer
+        log_writer_push(&log, (TickRecord){(uint32_t) i, (uint32_t) count_plants,
+                                           (uint32_t) count_herbivores, (uint32_t) count_carnivores});
+        trace_end(&ecoSystem.trace, PHASE_LOG);
+
+        // Hash the state this tick left behind
+        if (hash_file != NULL || hash_reference != NULL) {
+            uint64_t hash = state_hash(&ecoSystem);
+            if (hash_file != NULL) {
+                fprintf(hash_file, "%d %016llx\n", i, (unsigned long long) hash);
+            }
+            int match = hash_reference != NULL ? hash_check(hash_reference, i, hash) : 1;
+            if (match == 0) {
+                printf("Tick %d differs from the reference hashes in '%s'\n", i, config.hash_check_path);
+                diverged = 1;
+                break;
+            }
+            if (match < 0) {
+                printf("'%s' has no hash for tick %d, checking stopped\n", config.hash_check_path, i);
+                fclose(hash_reference);
+                hash_reference = NULL;
+            }
+        }
+
+        if (config.debug_tick > 0 && i % config.debug_tick == 0) {
+            trace_begin(&ecoSystem.trace, PHASE_DUMP);
+            printf("Tick %d: Plants: %d, Herbivores: %d, Carnivores: %d\n", i, count_plants, count_herbivores, count_carnivores);
+
+            // Print or snapshot the state of the grid
+            if (snapshot) {
+                snapshot_writer_push(&snapshots, (uint32_t) i, &TYPE(&ecoSystem, 0, 0), (size_t) ecoSystem.stride);
+            } else {
+                printf("State at Tick %d\n", i);
+                print_grid(&ecoSystem);
+            }
+            trace_end(&ecoSystem.trace, PHASE_DUMP);
+        }
+
+        // Checkpoint the state the next tick starts from
+        if (checkpoint && (i + 1) % config.checkpoint_every == 0) {
+            trace_begin(&ecoSystem.trace, PHASE_CHECKPOINT);
+            if (checkpoint_fork(&ecoSystem, config.checkpoint_path, (uint64_t) i + 1, config.engine,
+                                &checkpoint_child) != 0) {
+                checkpoint_failures++;
+            }
+            trace_end(&ecoSystem.trace, PHASE_CHECKPOINT);
+        }
+        trace_end_tick(&ecoSystem.trace, i);
+
+        if (count_herbivores == 0 || count_carnivores == 0) {
+            printf("Early stop\n");
+            break;
+        }
+    }
+
+    double elapsed = omp_get_wtime() - start;
+
+    // Print the final state of the ecosystem
+    if (config.debug_tick > 0 && i % config.debug_tick != 0) {  // Ensure final state is printed if it was not at a multiple of DEBUG_TICK
+        if (snapshot) {
+            snapshot_writer_push(&snapshots, (uint32_t) i, &TYPE(&ecoSystem, 0, 0), (size_t) ecoSystem.stride);
+        } else {
+            printf("Final state\n");
+            print_grid(&ecoSystem);
+        }
+        printf("Tick %d\n", i);
+    }
+
+    // Close the files
+    log_writer_close(&log);
+    if (log.stalls > 0) {
+        printf("Log writer fell behind %lld times\n", log.stalls);
+    }
+    if (stats_file != NULL) {
+        fclose(stats_file);
+    }
+    trace_close(&ecoSystem.trace);
+    if (hash_file != NULL) {
+        fclose(hash_file);
+    }
+    if (hash_reference != NULL) {
+        fclose(hash_reference);
+    }
+    if (snapshot) {
+        snapshot_writer_close(&snapshots);
+    }
+    if (checkpoint_wait(&checkpoint_child) != 0) {
+        checkpoint_failures++;
+    }
+    if (checkpoint_failures > 0) {
+        printf("%d checkpoints could not be written to '%s'\n", checkpoint_failures, config.checkpoint_path);
+    }
+    if (config.bench) {
+        printf("bench ticks=%d seconds=%.6f\n", ticks_run, elapsed);
+    }
+    destroy_ecosystem(&ecoSystem);
+
+    return diverged;
 }
@@ -3,16 +3,33 @@
 #include <stdlib.h>
 #include <math.h>
 
+// Headless builds (-DHEADLESS) keep only the timing line for the benchmark
+#ifdef HEADLESS
+#define trace(...) ((void) 0)
+#else
+#define trace(...) printf(__VA_ARGS__)
+#endif
+
+#ifndef GRID_SIZE
 #define GRID_SIZE 30
+#endif
 
+#ifndef PLANTS
 #define PLANTS 100
+#endif
+#ifndef HERBIVORES
 #define HERBIVORES 50
+#endif
+#ifndef CARNIVORES
 #define CARNIVORES 25
+#endif
 
 #define HERBIVORE_OLD 50
 #define CARNIVORE_OLD 50
 
+#ifndef MAX_TICKS
 #define MAX_TICKS 1000
+#endif
 #define STARVATION 10
 
 
@@ -122,7 +139,7 @@ void update_herbivore(EcoSystem *ecoSystem){
 
                 // Death by starvation
                 if (ecoSystem->grid[i][j].starve > STARVATION) {
-                    printf("Herbivore died by starvation\n");
+                    trace("Herbivore died by starvation\n");
                     ecoSystem->grid[i][j] = (Cell){0, 0, 0, false, EMPTY};  // The herbivore dies
                     continue;
                 }
@@ -133,7 +150,7 @@ void update_herbivore(EcoSystem *ecoSystem){
                 double death_by_age = death_probability(ecoSystem->grid[i][j].age, HERBIVORE_OLD, 2);
                 double r = (double) rand() / RAND_MAX;
                 if (r < death_by_age) {
-                    printf("Herbivore died by age\n");
+                    trace("Herbivore died by age\n");
 
                     ecoSystem->grid[i][j] = (Cell){0, 0, 0, false, EMPTY}; // The herbivore dies
 
@@ -166,7 +183,7 @@ void update_herbivore(EcoSystem *ecoSystem){
                     int e = ecoSystem -> grid[x][y].energy;  // Energy of the plant
                     ecoSystem -> grid[x][y] = (Cell){ecoSystem -> grid[i][j].energy + e, ecoSystem -> grid[i][j].age, 0, true, HERBIVORE};
                     ecoSystem -> grid[i][j] = (Cell){0, 0, 0, false, EMPTY}; // The herbivore moves to the plant cell
-                    printf("Herbivore ate plant, energy %d\n", ecoSystem -> grid[x][y].energy);
+                    trace("Herbivore ate plant, energy %d\n", ecoSystem -> grid[x][y].energy);
 
                 } else if (ecoSystem -> grid[x][y].type == EMPTY){
                     ecoSystem -> grid[i][j].starve += 1;
@@ -176,7 +193,7 @@ void update_herbivore(EcoSystem *ecoSystem){
                         ecoSystem -> grid[x][y] = (Cell){1, 0, 0, true, HERBIVORE}; // New herbivore is born
                         ecoSystem -> grid[i][j].energy -= 1;
 
-                        printf("Herbivore reproduced\n");
+                        trace("Herbivore reproduced\n");
                     } else {
                         // Herbivore moves to the empty cell
                         ecoSystem -> grid[x][y] = ecoSystem -> grid[i][j];
@@ -210,7 +227,7 @@ void update_herbivore(EcoSystem *ecoSystem){
                     }
 
                     if (ecoSystem -> grid[x][y].type == EMPTY) {
-                        printf("Herbivore moved to avoid carnivore\n");
+                        trace("Herbivore moved to avoid carnivore\n");
                         ecoSystem->grid[x][y] = ecoSystem->grid[i][j];
                         ecoSystem->grid[i][j] = (Cell){0, 0, 0, true, EMPTY}; // The herbivore moves to the empty cell
                     }
@@ -236,7 +253,7 @@ void update_carnivore(EcoSystem *ecoSystem){
 
                 // Death by starvation
                 if (ecoSystem->grid[i][j].starve > STARVATION + 3) {
-                    printf("Carnivore died by starvation\n");
+                    trace("Carnivore died by starvation\n");
 
                     ecoSystem->grid[i][j] = (Cell){0, 0, 0, false, EMPTY};  // The herbivore dies
 
@@ -280,7 +297,7 @@ void update_carnivore(EcoSystem *ecoSystem){
                     ecoSystem -> grid[x][y] = (Cell){ecoSystem -> grid[i][j].energy + e, ecoSystem -> grid[i][j].age, 0, true, CARNIVORE};
                     ecoSystem -> grid[i][j] = (Cell){0, 0, 0, false, EMPTY}; // The carnivore moves to the herbivore cell
 
-                    printf("Carnivore ate herbivore\n");
+                    trace("Carnivore ate herbivore\n");
                 } else if (ecoSystem -> grid[x][y].type == EMPTY){
                     ecoSystem -> grid[i][j].starve += 1;
 
@@ -289,7 +306,7 @@ void update_carnivore(EcoSystem *ecoSystem){
                         ecoSystem->grid[x][y] = (Cell){1, 0, 0, false, CARNIVORE}; // New carnivore is born
                         ecoSystem -> grid[i][j].energy -= 1;
 
-                        printf("Carnivore reproduced,  energy %d\n", ecoSystem -> grid[i][j].energy);
+                        trace("Carnivore reproduced,  energy %d\n", ecoSystem -> grid[i][j].energy);
                     } else {
                         // Carnivore moves to the empty cell
                         ecoSystem -> grid[x][y] = ecoSystem -> grid[i][j];
@@ -351,13 +368,24 @@ void init_ecosystem(EcoSystem *ecoSystem) {
 }
 
 
+#ifdef HEADLESS
+// Headless benchmark build: no output but the timing line, the tick count comes from the command line
+int main(int argc, char **argv) {
+    int max_ticks = argc > 1 ? atoi(argv[1]) : MAX_TICKS;
+#else
 int main() {
+    int max_ticks = MAX_TICKS;
+#endif
     // Configura la localización para soportar UTF-8
-    EcoSystem ecoSystem;
+    static EcoSystem ecoSystem;     // Static, so that large grids do not overflow the stack
     init_ecosystem(&ecoSystem);
 
-    for (int i = 0; i < MAX_TICKS; i++){
-        printf("Tick %d\n", i + 1);
+#ifdef HEADLESS
+    double start = omp_get_wtime();
+    int ticks = 0;
+#endif
+    for (int i = 0; i < max_ticks; i++){
+        trace("Tick %d\n", i + 1);
 
         int count_plants = 0;
         int count_herbivores = 0;
@@ -366,37 +394,43 @@ int main() {
             for (int k = 0; k < GRID_SIZE; k++) {
                 switch (ecoSystem.grid[t][k].type) {
                     case EMPTY:
-                        printf(" E ");
+                        trace(" E ");
                         break;
                     case PLANT:
-                        printf(" P ");
+                        trace(" P ");
                         count_plants++;
                         break;
                     case HERBIVORE:
-                        printf(" H ");
+                        trace(" H ");
                         count_herbivores++;
                         break;
                     case CARNIVORE:
-                        printf(" C ");
+                        trace(" C ");
                         count_carnivores++;
                         break;
                 }
             }
-            printf("\n");
+            trace("\n");
         }
-        printf("Plants: %d, Herbivores: %d, Carnivores: %d\n", count_plants, count_herbivores, count_carnivores);
-        printf("\n");
+        trace("Plants: %d, Herbivores: %d, Carnivores: %d\n", count_plants, count_herbivores, count_carnivores);
+        trace("\n");
 
         update_plant(&ecoSystem, 30);
         update_herbivore(&ecoSystem);
         update_carnivore(&ecoSystem);
         reset_acted(&ecoSystem);
+#ifdef HEADLESS
+        ticks++;
+#endif
 
         if (count_herbivores == 0 || count_carnivores == 0) {
-            printf("Early stop\n");
+            trace("Early stop\n");
             break;
         }
     }
+#ifdef HEADLESS
+    printf("bench ticks=%d seconds=%.6f\n", ticks, omp_get_wtime() - start);
+#endif
 
 //    for(int i = 0; i < MAX_TICKS; i++) {
 //        printf("Tick %d\n", i + 1);
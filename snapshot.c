@@ -0,0 +1,297 @@
+#include "snapshot.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// PackBits: a control byte n < 128 is followed by n + 1 literal bytes,
+// n >= 128 repeats the next byte n - 125 times (3 to 130).
+#define RLE_MAX_LITERAL 128
+#define RLE_MIN_RUN 3
+#define RLE_MAX_RUN 130
+
+// Worst case of rle_encode for n bytes
+static size_t rle_bound(size_t bytes) {
+    return bytes + bytes / RLE_MAX_LITERAL + 16;
+}
+
+static size_t rle_encode(const uint8_t *in, size_t bytes, uint8_t *out) {
+    size_t written = 0;
+    size_t i = 0;
+
+    while (i < bytes) {
+        // Length of the run starting at i
+        size_t run = 1;
+        while (i + run < bytes && run < RLE_MAX_RUN && in[i + run] == in[i]) run++;
+
+        if (run >= RLE_MIN_RUN) {
+            out[written++] = (uint8_t) (run + 125);
+            out[written++] = in[i];
+            i += run;
+            continue;
+        }
+
+        // Literals up to the next run of RLE_MIN_RUN equal bytes
+        size_t start = i;
+        while (i < bytes && i - start < RLE_MAX_LITERAL) {
+            if (i + 2 < bytes && in[i] == in[i + 1] && in[i] == in[i + 2]) break;
+            i++;
+        }
+        out[written++] = (uint8_t) (i - start - 1);
+        memcpy(out + written, in + start, i - start);
+        written += i - start;
+    }
+
+    return written;
+}
+
+static int rle_decode(const uint8_t *in, size_t bytes, uint8_t *out, size_t expected) {
+    size_t read = 0, written = 0;
+
+    while (read < bytes) {
+        uint8_t control = in[read++];
+        if (control < RLE_MAX_LITERAL) {
+            size_t count = (size_t) control + 1;
+            if (read + count > bytes || written + count > expected) return -1;
+            memcpy(out + written, in + read, count);
+            read += count;
+            written += count;
+        } else {
+            size_t count = (size_t) control - 125;
+            if (read >= bytes || written + count > expected) return -1;
+            memset(out + written, in[read++], count);
+            written += count;
+        }
+    }
+
+    return written == expected ? 0 : -1;
+}
+
+// Function to pack a type plane 4 cells per byte
+static void pack_types(const uint8_t *types, size_t cols, size_t stride, size_t cells, uint8_t *packed,
+                       size_t packed_bytes) {
+    #pragma omp parallel for schedule(static)
+    for (size_t b = 0; b < packed_bytes; b++) {
+        uint8_t byte = 0;
+        for (size_t k = 0; k < 4 && b * 4 + k < cells; k++) {
+            size_t c = b * 4 + k;
+            byte |= (uint8_t) ((types[c / cols * stride + c % cols] & 3) << (2 * k));
+        }
+        packed[b] = byte;
+    }
+}
+
+static void write_frame(SnapshotWriter *writer, uint32_t tick) {
+    uint8_t encoding = (uint8_t) writer->encoding;
+    const uint8_t *payload = writer->encoded;
+    uint64_t size;
+
+    if (encoding == SNAPSHOT_DELTA && !writer->has_previous) {
+        encoding = SNAPSHOT_RLE;  // Key frame
+    }
+
+    switch (encoding) {
+        case SNAPSHOT_RAW:
+            payload = writer->packed;
+            size = writer->packed_bytes;
+            break;
+        case SNAPSHOT_RLE:
+            size = rle_encode(writer->packed, writer->packed_bytes, writer->encoded);
+            break;
+        default:  // SNAPSHOT_DELTA, the XOR goes into `previous`, which is replaced below anyway
+            for (size_t b = 0; b < writer->packed_bytes; b++) {
+                writer->previous[b] ^= writer->packed[b];
+            }
+            size = rle_encode(writer->previous, writer->packed_bytes, writer->encoded);
+            break;
+    }
+
+    uint8_t header[16] = {0};
+    memcpy(header, &tick, sizeof(tick));
+    header[4] = encoding;
+    memcpy(header + 8, &size, sizeof(size));
+    fwrite(header, sizeof(header), 1, writer->file);
+    fwrite(payload, 1, size, writer->file);
+
+    // The frame just written is the reference of the next one
+    uint8_t *swap = writer->previous;
+    writer->previous = writer->packed;
+    writer->packed = swap;
+    writer->has_previous = true;
+}
+
+static void *writer_main(void *argument) {
+    SnapshotWriter *writer = argument;
+
+    pthread_mutex_lock(&writer->mutex);
+    for (;;) {
+        while (!writer->pending && !writer->closing) {
+            pthread_cond_wait(&writer->changed, &writer->mutex);
+        }
+        if (!writer->pending) break;  // Closing with nothing left to write
+
+        uint32_t tick = writer->pending_tick;
+        pthread_mutex_unlock(&writer->mutex);
+        write_frame(writer, tick);
+        pthread_mutex_lock(&writer->mutex);
+
+        writer->pending = false;
+        pthread_cond_broadcast(&writer->changed);
+    }
+    pthread_mutex_unlock(&writer->mutex);
+
+    fflush(writer->file);
+    return NULL;
+}
+
+int snapshot_writer_open(SnapshotWriter *writer, const char *path, int rows, int cols, SnapshotEncoding encoding) {
+    memset(writer, 0, sizeof(*writer));
+    writer->rows = rows;
+    writer->cols = cols;
+    writer->encoding = encoding;
+    writer->packed_bytes = ((size_t) rows * cols + 3) / 4;
+    writer->packed = malloc(writer->packed_bytes);
+    writer->previous = malloc(writer->packed_bytes);
+    writer->encoded = malloc(rle_bound(writer->packed_bytes));
+    writer->file = fopen(path, "wb");
+
+    if (writer->packed == NULL || writer->previous == NULL || writer->encoded == NULL || writer->file == NULL) {
+        free(writer->packed);
+        free(writer->previous);
+        free(writer->encoded);
+        if (writer->file != NULL) fclose(writer->file);
+        return -1;
+    }
+
+    int32_t dimensions[2] = {rows, cols};
+    fwrite(SNAPSHOT_MAGIC, 8, 1, writer->file);
+    fwrite(dimensions, sizeof(dimensions), 1, writer->file);
+
+    pthread_mutex_init(&writer->mutex, NULL);
+    pthread_cond_init(&writer->changed, NULL);
+    if (pthread_create(&writer->thread, NULL, writer_main, writer) != 0) {
+        pthread_cond_destroy(&writer->changed);
+        pthread_mutex_destroy(&writer->mutex);
+        free(writer->packed);
+        free(writer->previous);
+        free(writer->encoded);
+        fclose(writer->file);
+        writer->file = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+void snapshot_writer_push(SnapshotWriter *writer, uint32_t tick, const uint8_t *types, size_t stride) {
+    pthread_mutex_lock(&writer->mutex);
+    while (writer->pending) {
+        pthread_cond_wait(&writer->changed, &writer->mutex);
+    }
+    pthread_mutex_unlock(&writer->mutex);
+
+    // The thread is idle, so `packed` is free
+    pack_types(types, (size_t) writer->cols, stride, (size_t) writer->rows * writer->cols, writer->packed,
+               writer->packed_bytes);
+
+    pthread_mutex_lock(&writer->mutex);
+    writer->pending_tick = tick;
+    writer->pending = true;
+    pthread_cond_broadcast(&writer->changed);
+    pthread_mutex_unlock(&writer->mutex);
+}
+
+void snapshot_writer_close(SnapshotWriter *writer) {
+    if (writer->file == NULL) return;
+
+    pthread_mutex_lock(&writer->mutex);
+    writer->closing = true;
+    pthread_cond_broadcast(&writer->changed);
+    pthread_mutex_unlock(&writer->mutex);
+    pthread_join(writer->thread, NULL);
+
+    pthread_mutex_destroy(&writer->mutex);
+    pthread_cond_destroy(&writer->changed);
+    fclose(writer->file);
+    free(writer->packed);
+    free(writer->previous);
+    free(writer->encoded);
+    writer->file = NULL;
+}
+
+int snapshot_reader_open(SnapshotReader *reader, const char *path) {
+    memset(reader, 0, sizeof(*reader));
+    reader->file = fopen(path, "rb");
+    if (reader->file == NULL) return -1;
+
+    char magic[8];
+    int32_t dimensions[2];
+    if (fread(magic, sizeof(magic), 1, reader->file) != 1 || memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0
+        || fread(dimensions, sizeof(dimensions), 1, reader->file) != 1 || dimensions[0] < 1 || dimensions[1] < 1) {
+        fclose(reader->file);
+        return -1;
+    }
+
+    reader->rows = dimensions[0];
+    reader->cols = dimensions[1];
+    reader->packed_bytes = ((size_t) reader->rows * reader->cols + 3) / 4;
+    reader->packed = calloc(reader->packed_bytes, 1);
+    reader->encoded = malloc(rle_bound(reader->packed_bytes));
+    if (reader->packed == NULL || reader->encoded == NULL) {
+        snapshot_reader_close(reader);
+        return -1;
+    }
+
+    return 0;
+}
+
+int snapshot_reader_next(SnapshotReader *reader, uint32_t *tick, uint8_t *types) {
+    uint8_t header[16];
+    if (fread(header, sizeof(header), 1, reader->file) != 1) {
+        return 0;
+    }
+
+    uint64_t size;
+    memcpy(tick, header, sizeof(*tick));
+    memcpy(&size, header + 8, sizeof(size));
+    if (size > rle_bound(reader->packed_bytes) || fread(reader->encoded, 1, size, reader->file) != size) {
+        return -1;
+    }
+
+    switch (header[4]) {
+        case SNAPSHOT_RAW:
+            if (size != reader->packed_bytes) return -1;
+            memcpy(reader->packed, reader->encoded, size);
+            break;
+        case SNAPSHOT_RLE:
+            if (rle_decode(reader->encoded, size, reader->packed, reader->packed_bytes) != 0) return -1;
+            break;
+        case SNAPSHOT_DELTA: {
+            // Decode the XOR, then apply it to the previous frame
+            uint8_t *delta = malloc(reader->packed_bytes);
+            if (delta == NULL || rle_decode(reader->encoded, size, delta, reader->packed_bytes) != 0) {
+                free(delta);
+                return -1;
+            }
+            for (size_t b = 0; b < reader->packed_bytes; b++) {
+                reader->packed[b] ^= delta[b];
+            }
+            free(delta);
+            break;
+        }
+        default:
+            return -1;
+    }
+
+    size_t cells = (size_t) reader->rows * reader->cols;
+    for (size_t c = 0; c < cells; c++) {
+        types[c] = (reader->packed[c / 4] >> (2 * (c % 4))) & 3;
+    }
+    return 1;
+}
+
+void snapshot_reader_close(SnapshotReader *reader) {
+    if (reader->file != NULL) fclose(reader->file);
+    free(reader->packed);
+    free(reader->encoded);
+    memset(reader, 0, sizeof(*reader));
+}
@@ -0,0 +1,68 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#define SNAPSHOT_MAGIC "ECOSNAP1"   // First 8 bytes of a snapshot file
+
+// Frame payload encodings
+typedef enum {
+    SNAPSHOT_RAW,       // Type plane packed 2 bits per cell
+    SNAPSHOT_RLE,       // Packed plane, run-length encoded (PackBits)
+    SNAPSHOT_DELTA      // Packed plane XOR the previous frame, run-length encoded
+} SnapshotEncoding;
+
+// File layout: SNAPSHOT_MAGIC, int32 rows, int32 cols, then one frame per
+// snapshot: uint32 tick, uint8 encoding, 3 padding bytes, uint64 payload
+// size, payload. Cell c of the row-major type plane is bits 2 * (c % 4) of
+// packed byte c / 4. The first frame of a DELTA stream is stored as RLE.
+//
+// Writing is asynchronous: the simulation thread only packs the type plane
+// (4 cells per byte); encoding and I/O run on a background thread.
+typedef struct {
+    FILE *file;
+    int rows;
+    int cols;
+    SnapshotEncoding encoding;
+    size_t packed_bytes;
+    uint8_t *packed;            // Frame being handed to the writer thread
+    uint8_t *previous;          // Last frame written, reference of DELTA frames
+    uint8_t *encoded;
+    bool has_previous;
+
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;
+    bool pending;               // `packed` holds a frame the thread has not written yet
+    bool closing;
+    uint32_t pending_tick;
+} SnapshotWriter;
+
+typedef struct {
+    FILE *file;
+    int rows;
+    int cols;
+    size_t packed_bytes;
+    uint8_t *packed;            // Last decoded frame, reference of DELTA frames
+    uint8_t *encoded;
+} SnapshotReader;
+
+int snapshot_writer_open(SnapshotWriter *writer, const char *path, int rows, int cols, SnapshotEncoding encoding);
+
+// Function to queue the type plane of one tick, rows `stride` bytes apart; waits only while the previous
+// frame is still being written
+void snapshot_writer_push(SnapshotWriter *writer, uint32_t tick, const uint8_t *types, size_t stride);
+
+void snapshot_writer_close(SnapshotWriter *writer);
+
+int snapshot_reader_open(SnapshotReader *reader, const char *path);
+
+// Function to decode the next frame into `types` (rows * cols bytes); returns 1, 0 at the end, -1 on error
+int snapshot_reader_next(SnapshotReader *reader, uint32_t *tick, uint8_t *types);
+
+void snapshot_reader_close(SnapshotReader *reader);
+
+#endif
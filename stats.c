@@ -0,0 +1,72 @@
+#include "stats.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const char *SPECIES_NAMES[SPECIES] = {"plants", "herbivores", "carnivores"};
+static const char *DEATH_NAMES[DEATH_CAUSES] = {"starvation", "age", "predation", "overpopulation"};
+
+int stats_init(Stats *stats, int threads) {
+    stats->threads = threads;
+    stats->slots = aligned_alloc(STATS_CACHE_LINE, (size_t) threads * sizeof(ThreadStats));
+    if (stats->slots == NULL) {
+        return -1;
+    }
+
+    stats_begin_tick(stats);
+    return 0;
+}
+
+void stats_free(Stats *stats) {
+    free(stats->slots);
+    stats->slots = NULL;
+    stats->threads = 0;
+}
+
+void stats_begin_tick(Stats *stats) {
+    memset(stats->slots, 0, (size_t) stats->threads * sizeof(ThreadStats));
+}
+
+void stats_add(TickStats *total, const TickStats *part) {
+    for (int s = 0; s < SPECIES; s++) {
+        total->population[s] += part->population[s];
+        total->energy[s] += part->energy[s];
+        total->births[s] += part->births[s];
+        total->moves[s] += part->moves[s];
+        for (int d = 0; d < DEATH_CAUSES; d++) {
+            total->deaths[s][d] += part->deaths[s][d];
+        }
+    }
+}
+
+void stats_merge(const Stats *stats, TickStats *total) {
+    memset(total, 0, sizeof(*total));
+
+    for (int t = 0; t < stats->threads; t++) {
+        stats_add(total, &stats->slots[t].stats);
+    }
+}
+
+void stats_write_header(FILE *file) {
+    fprintf(file, "tick");
+    for (int s = 0; s < SPECIES; s++) {
+        fprintf(file, ",%s,%s_energy,%s_births,%s_moves", SPECIES_NAMES[s], SPECIES_NAMES[s], SPECIES_NAMES[s],
+                SPECIES_NAMES[s]);
+        for (int d = 0; d < DEATH_CAUSES; d++) {
+            fprintf(file, ",%s_deaths_%s", SPECIES_NAMES[s], DEATH_NAMES[d]);
+        }
+    }
+    fprintf(file, "\n");
+}
+
+void stats_write_row(FILE *file, long long tick, const TickStats *total) {
+    fprintf(file, "%lld", tick);
+    for (int s = 0; s < SPECIES; s++) {
+        fprintf(file, ",%lld,%lld,%lld,%lld", total->population[s], total->energy[s], total->births[s],
+                total->moves[s]);
+        for (int d = 0; d < DEATH_CAUSES; d++) {
+            fprintf(file, ",%lld", total->deaths[s][d]);
+        }
+    }
+    fprintf(file, "\n");
+}
@@ -0,0 +1,58 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <omp.h>
+
+#define SPECIES 3               // PLANT, HERBIVORE and CARNIVORE, in CellType order
+#define STATS_CACHE_LINE 64
+
+// Causes of death
+typedef enum {
+    DEATH_STARVATION,
+    DEATH_AGE,
+    DEATH_PREDATION,
+    DEATH_OVERPOPULATION,
+    DEATH_CAUSES
+} DeathCause;
+
+// Statistics of one tick, every array indexed by species
+typedef struct {
+    long long population[SPECIES];    // Agents that took a turn this tick
+    long long energy[SPECIES];        // Their total energy when they took it
+    long long births[SPECIES];
+    long long deaths[SPECIES][DEATH_CAUSES];
+    long long moves[SPECIES];         // Moves into an empty cell or into a prey's cell
+} TickStats;
+
+// One accumulator per thread, each on its own cache lines so that no two threads write the same line
+typedef struct {
+    _Alignas(STATS_CACHE_LINE) TickStats stats;
+} ThreadStats;
+
+typedef struct {
+    int threads;
+    ThreadStats *slots;
+} Stats;
+
+int stats_init(Stats *stats, int threads);
+void stats_free(Stats *stats);
+
+// Function to clear every thread's accumulator at the start of a tick
+void stats_begin_tick(Stats *stats);
+
+// Function to add the counters of `part` to `total`
+void stats_add(TickStats *total, const TickStats *part);
+
+// Function to add up the per-thread accumulators once the tick is over
+void stats_merge(const Stats *stats, TickStats *total);
+
+void stats_write_header(FILE *file);
+void stats_write_row(FILE *file, long long tick, const TickStats *total);
+
+// Accumulator of the calling thread
+static inline TickStats *stats_local(Stats *stats) {
+    return &stats->slots[omp_get_thread_num()].stats;
+}
+
+#endif
@@ -0,0 +1,119 @@
+#include "trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const char *PHASE_NAMES[PHASES] = {"reset_acted", "sweep", "log", "dump", "checkpoint"};
+
+// Function to open a Chrome trace event (',' separated) in the output array
+static void chrome_event(Trace *trace) {
+    fprintf(trace->file, trace->first_event ? "\n" : ",\n");
+    trace->first_event = false;
+}
+
+int trace_open(Trace *trace, const char *path, TraceFormat format, int threads) {
+    trace->file = fopen(path, "w");
+    if (trace->file == NULL) {
+        return -1;
+    }
+    trace->slots = aligned_alloc(TRACE_CACHE_LINE, (size_t) threads * sizeof(ThreadTrace));
+    if (trace->slots == NULL) {
+        fclose(trace->file);
+        trace->file = NULL;
+        return -1;
+    }
+    memset(trace->slots, 0, (size_t) threads * sizeof(ThreadTrace));
+    trace->threads = threads;
+    trace->format = format;
+    trace->origin = omp_get_wtime();
+    trace->first_event = true;
+
+    if (format == TRACE_CSV) {
+        fprintf(trace->file, "tick,thread");
+        for (int p = 0; p < PHASES; p++) {
+            fprintf(trace->file, ",%s_s", PHASE_NAMES[p]);
+        }
+        fprintf(trace->file, ",cells,locks,contended,wait_s,imbalance_time,imbalance_cells\n");
+    } else {
+        fprintf(trace->file, "[");
+        for (int t = 0; t < threads; t++) {
+            chrome_event(trace);
+            fprintf(trace->file, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": %d, "
+                                 "\"args\": {\"name\": \"omp thread %d\"}}", t, t);
+        }
+    }
+    return 0;
+}
+
+void trace_end_tick(Trace *trace, long long tick) {
+    if (trace->slots == NULL) {
+        return;
+    }
+
+    // Load imbalance of the sweep: slowest (busiest) thread over the mean of the threads in the team,
+    // 1 when perfectly balanced
+    double max_time = 0, sum_time = 0;
+    long long max_cells = 0, sum_cells = 0;
+    int team = 0;
+    for (int t = 0; t < trace->threads; t++) {
+        const ThreadTrace *slot = &trace->slots[t];
+        if (slot->first[PHASE_SWEEP] == 0) continue;
+        team++;
+        sum_time += slot->time[PHASE_SWEEP];
+        sum_cells += slot->cells;
+        if (slot->time[PHASE_SWEEP] > max_time) max_time = slot->time[PHASE_SWEEP];
+        if (slot->cells > max_cells) max_cells = slot->cells;
+    }
+    double imbalance_time = sum_time > 0 ? max_time * team / sum_time : 1;
+    double imbalance_cells = sum_cells > 0 ? (double) max_cells * team / sum_cells : 1;
+
+    double tick_start = 0;
+    for (int t = 0; t < trace->threads; t++) {
+        const ThreadTrace *slot = &trace->slots[t];
+        if (trace->format == TRACE_CSV) {
+            fprintf(trace->file, "%lld,%d", tick, t);
+            for (int p = 0; p < PHASES; p++) {
+                fprintf(trace->file, ",%.9f", slot->time[p]);
+            }
+            fprintf(trace->file, ",%lld,%lld,%lld,%.9f,%.4f,%.4f\n", slot->cells, slot->locks, slot->contended,
+                    slot->wait, imbalance_time, imbalance_cells);
+            continue;
+        }
+
+        // One complete event per phase the thread took part in, from its first entry, lasting the time spent
+        for (int p = 0; p < PHASES; p++) {
+            if (slot->first[p] == 0) continue;
+            if (tick_start == 0 || slot->first[p] < tick_start) tick_start = slot->first[p];
+            chrome_event(trace);
+            fprintf(trace->file, "{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 0, \"tid\": %d, \"ts\": %.3f, "
+                                 "\"dur\": %.3f, \"args\": {\"tick\": %lld",
+                    PHASE_NAMES[p], t, (slot->first[p] - trace->origin) * 1e6, slot->time[p] * 1e6, tick);
+            if (p == PHASE_SWEEP) {
+                fprintf(trace->file, ", \"cells\": %lld, \"locks\": %lld, \"contended\": %lld, \"wait_us\": %.3f",
+                        slot->cells, slot->locks, slot->contended, slot->wait * 1e6);
+            }
+            fprintf(trace->file, "}}");
+        }
+    }
+    if (trace->format == TRACE_CHROME && tick_start > 0) {
+        chrome_event(trace);
+        fprintf(trace->file, "{\"name\": \"load imbalance\", \"ph\": \"C\", \"pid\": 0, \"ts\": %.3f, "
+                             "\"args\": {\"time\": %.4f, \"cells\": %.4f}}",
+                (tick_start - trace->origin) * 1e6, imbalance_time, imbalance_cells);
+    }
+
+    memset(trace->slots, 0, (size_t) trace->threads * sizeof(ThreadTrace));
+}
+
+void trace_close(Trace *trace) {
+    if (trace->file != NULL) {
+        if (trace->format == TRACE_CHROME) {
+            fprintf(trace->file, "\n]\n");
+        }
+        fclose(trace->file);
+    }
+    free(trace->slots);
+    trace->file = NULL;
+    trace->slots = NULL;
+    trace->threads = 0;
+}
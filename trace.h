@@ -0,0 +1,101 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <omp.h>
+
+// Per-phase instrumentation (--trace). The hooks below only exist in builds
+// with ECO_TRACE defined (the MiniProyecto_1_trace target); everywhere else
+// they are macros that expand to nothing, or to the plain omp_set_lock, so the
+// normal build pays nothing for them.
+
+#define TRACE_CACHE_LINE 64
+
+typedef enum {
+    PHASE_RESET,        // Clearing the acted stamps when their epoch wraps
+    PHASE_SWEEP,        // Updating the agents (every parallel region of the step)
+    PHASE_LOG,          // Log record and statistics row
+    PHASE_DUMP,         // Printed grid or snapshot
+    PHASE_CHECKPOINT,   // Forking the checkpoint writer
+    PHASES
+} TracePhase;
+
+typedef enum {
+    TRACE_CHROME,       // Chrome trace event JSON (chrome://tracing, Perfetto)
+    TRACE_CSV           // One row per tick and thread
+} TraceFormat;
+
+// Counters of one thread for the current tick, each on its own cache lines
+typedef struct {
+    _Alignas(TRACE_CACHE_LINE) double first[PHASES];   // When the phase was first entered this tick, 0 if never
+    double entered[PHASES];                             // When the phase was last entered
+    double time[PHASES];                                // Seconds spent in the phase this tick
+    long long cells;                                    // Cells the sweep went over
+    long long locks;                                    // Cell locks acquired
+    long long contended;                                // Acquisitions that found the lock taken
+    double wait;                                        // Seconds spent waiting for those
+} ThreadTrace;
+
+typedef struct {
+    int threads;
+    ThreadTrace *slots;     // NULL while tracing is off
+    FILE *file;
+    TraceFormat format;
+    double origin;          // omp_get_wtime() when the trace was opened; timestamps are relative to it
+    bool first_event;
+} Trace;
+
+int trace_open(Trace *trace, const char *path, TraceFormat format, int threads);
+
+// Function to write the counters of every thread for `tick` and clear them for the next one
+void trace_end_tick(Trace *trace, long long tick);
+
+void trace_close(Trace *trace);
+
+#ifdef ECO_TRACE
+
+static inline void trace_begin(Trace *trace, TracePhase phase) {
+    if (trace->slots == NULL) return;
+    ThreadTrace *slot = &trace->slots[omp_get_thread_num()];
+    double now = omp_get_wtime();
+    if (slot->first[phase] == 0) slot->first[phase] = now;
+    slot->entered[phase] = now;
+}
+
+static inline void trace_end(Trace *trace, TracePhase phase) {
+    if (trace->slots == NULL) return;
+    ThreadTrace *slot = &trace->slots[omp_get_thread_num()];
+    slot->time[phase] += omp_get_wtime() - slot->entered[phase];
+}
+
+static inline void trace_cells(Trace *trace, long long cells) {
+    if (trace->slots != NULL) trace->slots[omp_get_thread_num()].cells += cells;
+}
+
+// Function to take a lock, counting it and timing the wait when another thread holds it
+static inline void trace_lock(Trace *trace, omp_lock_t *lock) {
+    if (trace->slots == NULL) {
+        omp_set_lock(lock);
+        return;
+    }
+    ThreadTrace *slot = &trace->slots[omp_get_thread_num()];
+    slot->locks++;
+    if (!omp_test_lock(lock)) {
+        double start = omp_get_wtime();
+        omp_set_lock(lock);
+        slot->contended++;
+        slot->wait += omp_get_wtime() - start;
+    }
+}
+
+#else
+
+#define trace_begin(trace, phase) ((void) 0)
+#define trace_end(trace, phase) ((void) 0)
+#define trace_cells(trace, cells) ((void) 0)
+#define trace_lock(trace, lock) omp_set_lock(lock)
+
+#endif
+
+#endif